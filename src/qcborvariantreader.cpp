@@ -1,14 +1,36 @@
 #include "qcborvariantreader.h"
 #include <QCborValue>
 #include <QCborStreamReader>
+#include <QAnyStringView>
+
+#include "qvarianthandler.h"
 
 QCborVariantReader::QCborVariantReader(QIODevice *device):
-    QCborVariantReader(device->readAll())
+    QCborVariantReader(device, false)
+{
+
+}
+
+QCborVariantReader::QCborVariantReader(QIODevice *device, bool stream):
+    m_device(nullptr),
+    m_size(0)
 {
+    // a file is parsed straight from its mapping
+    m_data = mapFile(device);
+    if (m_data.isNull() && stream) {
+        m_device = new QCborStreamReader(device);
+        m_size = device->isSequential() ? device->bytesAvailable() : device->size() - device->pos();
+        return;
+    }
+    if (m_data.isNull())
+        m_data = device->readAll();
 
+    m_device = new QCborStreamReader(m_data);
+    m_size = m_data.size();
 }
 
 QCborVariantReader::QCborVariantReader(const QByteArray &data):
+    m_data(data),
     m_device(new QCborStreamReader(data)),
     m_size(data.size())
 {
@@ -40,18 +62,136 @@ QVariantReader::Type QCborVariantReader::type() const
     }
 }
 
+bool QCborVariantReader::skipValue()
+{
+    // a tag is its own element in the stream, the tagged value follows it
+    while (m_device->isTag()) {
+        if (!m_device->next())
+            return false;
+    }
+    return m_device->next();
+}
+
+QString QCborVariantReader::readKey()
+{
+    if (m_device->type() == QCborStreamReader::String)
+        return readString(true);
+    return QVariantReader::readKey();
+}
+
 QVariant QCborVariantReader::readValue()
 {
     switch (m_device->type()) {
     case QCborStreamReader::ByteArray:
         return m_device->readAllByteArray();
     case QCborStreamReader::String:
-        return m_device->readAllString();
+        return readString(false);
     default:
         return QCborValue::fromCbor(*m_device).toVariant();
     }
 }
 
+bool QCborVariantReader::matchKey(QStringView key)
+{
+    if (m_device->type() != QCborStreamReader::String)
+        return QVariantReader::matchKey(key);
+    if (!readUtf8String())
+        return false;
+    return QAnyStringView::equal(QUtf8StringView(m_stringBuffer), key);
+}
+
+bool QCborVariantReader::parseKey(QVariantHandler *handler)
+{
+    if (m_device->type() != QCborStreamReader::String)
+        return QVariantReader::parseKey(handler);
+    if (!readUtf8String())
+        return false;
+    return handler->key(QUtf8StringView(m_stringBuffer));
+}
+
+bool QCborVariantReader::parseValue(QVariantHandler *handler)
+{
+    if (m_device->type() != QCborStreamReader::String)
+        return QVariantReader::parseValue(handler);
+    // CBOR text is UTF-8 already, the view is over the reused chunk buffer
+    if (!readUtf8String())
+        return false;
+    return handler->string(QUtf8StringView(m_stringBuffer));
+}
+
+bool QCborVariantReader::readUtf8String()
+{
+    m_stringBuffer.resize(0);
+    forever {
+        const qsizetype offset = m_stringBuffer.size();
+        const qsizetype size = qMax<qsizetype>(m_device->currentStringChunkSize(), 0);
+        m_stringBuffer.resize(offset + size);
+        const auto result = m_device->readStringChunk(m_stringBuffer.data() + offset, size);
+        if (result.status == QCborStreamReader::Error)
+            return false;
+        if (result.status == QCborStreamReader::EndOfString) {
+            m_stringBuffer.resize(offset);
+            return true;
+        }
+        m_stringBuffer.resize(offset + result.data);
+    }
+}
+
+QString QCborVariantReader::readString(bool isKey)
+{
+    // a chunked string only tells its length once its chunks are gathered
+    const bool isLengthKnown = m_device->isLengthKnown();
+    if (isLengthKnown && !isInternable(isKey, m_device->length()))
+        return m_device->readAllString();
+
+    // gather the UTF-8 bytes so a pooled string can be found without decoding
+    if (!readUtf8String())
+        return QString();
+    if (!isLengthKnown && !isInternable(isKey, m_stringBuffer.size()))
+        return QString::fromUtf8(m_stringBuffer);
+
+    QString string = internedString(m_stringBuffer.constData(), m_stringBuffer.size());
+    if (string.isNull()) {
+        string = QString::fromUtf8(m_stringBuffer);
+        internString(m_stringBuffer.constData(), m_stringBuffer.size(), string);
+    }
+    return string;
+}
+
+bool QCborVariantReader::validateValue()
+{
+    switch (m_device->type()) {
+    case QCborStreamReader::Array:
+    case QCborStreamReader::Map:
+        // map keys are plain values in the stream
+        if (!m_device->enterContainer())
+            return false;
+        while (!hasError() && m_device->hasNext()) {
+            if (!validateValue())
+                return false;
+        }
+        return !hasError() && m_device->leaveContainer();
+    case QCborStreamReader::Tag:
+        // the tagged value follows as its own element
+        return m_device->next() && validateValue();
+    case QCborStreamReader::Invalid:
+        return false;
+    default:
+        // skipping a text string checks its UTF-8 without decoding it,
+        // failing at the same offset as readAllString() in read()
+        return m_device->next();
+    }
+}
+
+bool QCborVariantReader::validateReader(QCborVariantReader &reader, QCborParserError *error)
+{
+    // the pass stops where read() would, so its error is the one to report
+    reader.validateValue();
+    if(error)
+        *error = reader.error();
+    return !reader.hasError();
+}
+
 QCborParserError QCborVariantReader::error() const
 {
     QCborParserError error;
@@ -77,3 +217,24 @@ QVariant QCborVariantReader::fromCbor(QIODevice* device, QCborParserError* error
         *error = reader.error();
     return variant;
 }
+
+bool QCborVariantReader::validate(const QByteArray& cbor, QCborParserError* error)
+{
+    QCborVariantReader reader(cbor);
+    return validateReader(reader, error);
+}
+
+bool QCborVariantReader::validate(QIODevice* device, QCborParserError* error)
+{
+    QCborVariantReader reader(device);
+    return validateReader(reader, error);
+}
+
+QVariantList QCborVariantReader::extract(const QByteArray& cbor, const QStringList& pointers, QCborParserError* error)
+{
+    QCborVariantReader reader(cbor);
+    QVariantList values = reader.extract(pointers);
+    if(error)
+        *error = reader.error();
+    return values;
+}
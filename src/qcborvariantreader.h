@@ -29,6 +29,9 @@ public:
     bool enterContainer() final override { return m_device->enterContainer(); }
     bool leaveContainer() final override { return m_device->leaveContainer(); }
 
+    bool skipValue() final override;
+
+    QString readKey() final override;
     QVariant readValue() final override ;
 
     QCborError lastError() const { return m_device->lastError(); }
@@ -38,11 +41,33 @@ public:
 
     static QVariant fromCbor(const QByteArray& cbor, QCborParserError* error = nullptr);
     static QVariant fromCbor(QIODevice* device, QCborParserError* error = nullptr);
+    static QVariantList extract(const QByteArray& cbor, const QStringList& pointers, QCborParserError* error = nullptr);
+
+    static bool validate(const QByteArray& cbor, QCborParserError* error = nullptr);
+    static bool validate(QIODevice* device, QCborParserError* error = nullptr);
+
+protected:
+    bool matchKey(QStringView key) final override;
+    bool parseKey(QVariantHandler *handler) final override;
+    bool parseValue(QVariantHandler *handler) final override;
 
 private:
+    friend class QJsonCborTranscoder;
+
+    // With stream set, a device that cannot be mapped is read through
+    // QCborStreamReader as the reader goes instead of being read whole.
+    QCborVariantReader(QIODevice *device, bool stream);
+
+    bool readUtf8String();
+    QString readString(bool isKey);
+    bool validateValue();
+    static bool validateReader(QCborVariantReader &reader, QCborParserError *error);
+
+    QByteArray m_data;
     QCborStreamReader *m_device;
+    QByteArray m_stringBuffer;
 
-    const qint64 m_size;
+    qint64 m_size;
 };
 
 #endif // QCBORVARIANTREADER_H
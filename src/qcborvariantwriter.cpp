@@ -2,6 +2,13 @@
 #include <QCborStreamWriter>
 #include <QCborValue>
 #include <QIODevice>
+#include <QMetaProperty>
+#include <QVarLengthArray>
+#include <QThreadPool>
+
+#include "qutf8.h"
+#include "qparallelwriter.h"
+#include "qvariantpairlist.h"
 
 static void variantToCbor(const QVariant &value, QCborStreamWriter &writer, int opt);
 
@@ -26,6 +33,31 @@ static inline void variantObjectToCbor(const T& object, QCborStreamWriter &write
     }
     writer.endMap();
 }
+static inline void variantObjectToCbor(const QVariantPairList& object, QCborStreamWriter &writer, int opt)
+{
+    writer.startMap(object.size());
+    for (const auto &pair: object) {
+        writer.append(pair.first);
+        variantToCbor(pair.second, writer, opt);
+    }
+    writer.endMap();
+}
+static inline void gadgetToCbor(const void *gadget, const QMetaObject *metaObject, QCborStreamWriter &writer, int opt)
+{
+    QVarLengthArray<QMetaProperty, 16> properties;
+    for (int i = 0; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty property = metaObject->property(i);
+        if (property.isReadable() && property.isStored())
+            properties.append(property);
+    }
+
+    writer.startMap(properties.size());
+    for (const QMetaProperty &property: properties) {
+        writer.append(QLatin1String(property.name()));
+        variantToCbor(property.readOnGadget(gadget), writer, opt);
+    }
+    writer.endMap();
+}
 static inline void variantValueToCbor(const QVariant &value, QCborStreamWriter &writer, int opt)
 {
     switch (value.metaType().id()) {
@@ -60,22 +92,271 @@ void variantToCbor(const QVariant &value, QCborStreamWriter &writer, int opt)
         break;
     }
     default: {
+        if (value.metaType() == QMetaType::fromType<QVariantPairList>()) {
+            variantObjectToCbor(value.value<QVariantPairList>(), writer, opt);
+            break;
+        }
+        if (value.metaType().flags() & QMetaType::IsGadget) {
+            gadgetToCbor(value.constData(), value.metaType().metaObject(), writer, opt);
+            break;
+        }
         variantValueToCbor(value, writer, opt);
         break;
     }
     }
 }
 
+// Parallel writing: the members of large containers are written in slices
+// on a thread pool, see QParallelWriter. Slices reach the device directly,
+// so the containers around them get their heads written here, the way
+// QCborStreamWriter writes the head of a container of known size; smaller
+// ones are walked so that large ones further down are still split.
+
+static void variantToCborParallel(const QVariant &value, QCborStreamWriter &writer, int opt, QThreadPool *pool);
+
+enum : quint8 { ArrayHead = 0x80, MapHead = 0xa0 };
+
+static inline void headToCbor(QIODevice *device, quint8 majorType, quint64 count)
+{
+    char head[9];
+    qsizetype size;
+    if (count < 24) {
+        head[0] = char(majorType | count);
+        size = 1;
+    } else if (count <= 0xff) {
+        head[0] = char(majorType | 24);
+        size = 2;
+    } else if (count <= 0xffff) {
+        head[0] = char(majorType | 25);
+        size = 3;
+    } else if (count <= 0xffffffffu) {
+        head[0] = char(majorType | 26);
+        size = 5;
+    } else {
+        head[0] = char(majorType | 27);
+        size = 9;
+    }
+    // the argument follows in network byte order
+    for (qsizetype i = size - 1; i > 0; --i, count >>= 8)
+        head[i] = char(count & 0xff);
+    device->write(head, size);
+}
+// member(writer, it, pool) writes a member; slices pass no pool, so their
+// members are written sequentially
+template<typename It, typename Member>
+static void membersToCborParallel(It begin, qsizetype size, QCborStreamWriter &writer, QThreadPool *pool, const Member &member)
+{
+    const qsizetype sliceSize = QParallelWriter::sliceSize(size, pool);
+    if (sliceSize == 0) {
+        It it = begin;
+        for (qsizetype i = 0; i < size; ++i, ++it)
+            member(writer, it, pool);
+        return;
+    }
+
+    const QList<It> starts = QParallelWriter::sliceStarts(begin, size, sliceSize);
+    QParallelWriter::writeSlices(starts.size(), pool, [&](qsizetype i, QByteArray *buffer) {
+        QCborStreamWriter out(buffer);
+        It it = starts.at(i);
+        const qsizetype last = qMin((i + 1) * sliceSize, size);
+        for (qsizetype j = i * sliceSize; j < last; ++j, ++it)
+            member(out, it, nullptr);
+    }, [&](const QByteArray &buffer) {
+        writer.device()->write(buffer);
+    });
+}
+void variantToCborParallel(const QVariant &value, QCborStreamWriter &writer, int opt, QThreadPool *pool)
+{
+    if (!pool) {
+        variantToCbor(value, writer, opt);
+        return;
+    }
+
+    const auto listMember = [&](QCborStreamWriter &out, auto it, QThreadPool *memberPool) {
+        variantToCborParallel(*it, out, opt, memberPool);
+    };
+    const auto mapMember = [&](QCborStreamWriter &out, auto it, QThreadPool *memberPool) {
+        out.append(it.key());
+        variantToCborParallel(it.value(), out, opt, memberPool);
+    };
+
+    switch (value.metaType().id()) {
+    case QMetaType::QStringList: {
+        const QStringList list = value.toStringList();
+        headToCbor(writer.device(), ArrayHead, list.size());
+        membersToCborParallel(list.begin(), list.size(), writer, pool, listMember);
+        break;
+    }
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        headToCbor(writer.device(), ArrayHead, list.size());
+        membersToCborParallel(list.begin(), list.size(), writer, pool, listMember);
+        break;
+    }
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        headToCbor(writer.device(), MapHead, map.size());
+        membersToCborParallel(map.begin(), map.size(), writer, pool, mapMember);
+        break;
+    }
+    case QMetaType::QVariantHash: {
+        const QVariantHash hash = value.toHash();
+        headToCbor(writer.device(), MapHead, hash.size());
+        membersToCborParallel(hash.begin(), hash.size(), writer, pool, mapMember);
+        break;
+    }
+    default: {
+        if (value.metaType() == QMetaType::fromType<QVariantPairList>()) {
+            const QVariantPairList pairs = value.value<QVariantPairList>();
+            headToCbor(writer.device(), MapHead, pairs.size());
+            membersToCborParallel(pairs.begin(), pairs.size(), writer, pool,
+                                  [&](QCborStreamWriter &out, QVariantPairList::const_iterator it, QThreadPool *memberPool) {
+                out.append(it->first);
+                variantToCborParallel(it->second, out, opt, memberPool);
+            });
+            break;
+        }
+        variantToCbor(value, writer, opt);
+        break;
+    }
+    }
+}
+
+// Sizing pass: the exact number of bytes the functions above write.
+
+static qsizetype variantCborSize(const QVariant &value, int opt);
+
+// The initial byte and the argument following it
+static inline qsizetype headCborSize(quint64 argument)
+{
+    if (argument < 24)
+        return 1;
+    if (argument <= 0xff)
+        return 2;
+    if (argument <= 0xffff)
+        return 3;
+    if (argument <= 0xffffffffu)
+        return 5;
+    return 9;
+}
+static inline qsizetype integerCborSize(qint64 value)
+{
+    // negative integers store -1 - value
+    return headCborSize(value < 0 ? quint64(-1 - value) : quint64(value));
+}
+static inline qsizetype stringCborSize(QStringView string)
+{
+    const qsizetype size = QUtf8::utf8Size(string.utf16(), string.utf16() + string.size());
+    if (size >= 0)
+        return headCborSize(quint64(size)) + size;
+    // lone surrogates: measure what the stream writer is handed
+    const qsizetype utf8 = string.toUtf8().size();
+    return headCborSize(quint64(utf8)) + utf8;
+}
+static inline qsizetype latin1CborSize(const char *string)
+{
+    // non-ASCII Latin-1 takes two bytes in UTF-8
+    qsizetype size = 0;
+    for (const char *p = string; *p; ++p)
+        size += uchar(*p) < 0x80 ? 1 : 2;
+    return headCborSize(quint64(size)) + size;
+}
+template<typename T>
+static inline qsizetype variantListCborSize(const QList<T>& array, int opt)
+{
+    qsizetype size = headCborSize(quint64(array.size()));
+    for(const T& variant: array)
+        size += variantCborSize(variant, opt);
+    return size;
+}
+template<typename T>
+static inline qsizetype variantObjectCborSize(const T& object, int opt)
+{
+    qsizetype size = headCborSize(quint64(object.size()));
+    auto it = object.begin();
+    auto end = object.end();
+    for ( ; it != end; ++it)
+        size += stringCborSize(it.key()) + variantCborSize(it.value(), opt);
+    return size;
+}
+static inline qsizetype variantObjectCborSize(const QVariantPairList& object, int opt)
+{
+    qsizetype size = headCborSize(quint64(object.size()));
+    for (const auto &pair: object)
+        size += stringCborSize(pair.first) + variantCborSize(pair.second, opt);
+    return size;
+}
+static inline qsizetype gadgetCborSize(const void *gadget, const QMetaObject *metaObject, int opt)
+{
+    qsizetype size = 0;
+    quint64 count = 0;
+    for (int i = 0; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty property = metaObject->property(i);
+        if (!property.isReadable() || !property.isStored())
+            continue;
+        ++count;
+        size += latin1CborSize(property.name()) + variantCborSize(property.readOnGadget(gadget), opt);
+    }
+    return headCborSize(count) + size;
+}
+static inline qsizetype variantValueCborSize(const QVariant &value, int opt)
+{
+    switch (value.metaType().id()) {
+    case QMetaType::QByteArray: {
+        const qsizetype size = value.toByteArray().size();
+        return headCborSize(quint64(size)) + size;
+    }
+    case QMetaType::QString:
+        return stringCborSize(value.toString());
+    case QMetaType::Bool:
+    case QMetaType::Nullptr:
+        return 1;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+        return integerCborSize(value.toLongLong());
+    case QMetaType::Double:
+        // without options doubles are always written in full
+        if (opt == 0)
+            return 9;
+        Q_FALLTHROUGH();
+    default:
+        // the conversions QCborValue applies are its own: measure them
+        return QCborValue::fromVariant(value).toCbor((QCborValue::EncodingOptions)opt).size();
+    }
+}
+qsizetype variantCborSize(const QVariant &value, int opt)
+{
+    switch (value.metaType().id()) {
+    case QMetaType::QStringList:
+        return variantListCborSize(value.toStringList(), opt);
+    case QMetaType::QVariantList:
+        return variantListCborSize(value.toList(), opt);
+    case QMetaType::QVariantMap:
+        return variantObjectCborSize(value.toMap(), opt);
+    case QMetaType::QVariantHash:
+        return variantObjectCborSize(value.toHash(), opt);
+    default:
+        if (value.metaType() == QMetaType::fromType<QVariantPairList>())
+            return variantObjectCborSize(value.value<QVariantPairList>(), opt);
+        if (value.metaType().flags() & QMetaType::IsGadget)
+            return gadgetCborSize(value.constData(), value.metaType().metaObject(), opt);
+        return variantValueCborSize(value, opt);
+    }
+}
+
 QCborVariantWriter::QCborVariantWriter(QIODevice *device, int options):
     m_device(new QCborStreamWriter(device)),
-    m_options(options)
+    m_options(options),
+    m_threadPool(nullptr)
 {
 
 }
 
 QCborVariantWriter::QCborVariantWriter(QByteArray *data, int options):
     m_device(new QCborStreamWriter(data)),
-    m_options(options)
+    m_options(options),
+    m_threadPool(nullptr)
 {
 
 }
@@ -89,6 +370,14 @@ void QCborVariantWriter::start()
 {
     m_device->device()->open(QIODevice::WriteOnly | QIODevice::Unbuffered);
 }
+QThreadPool *QCborVariantWriter::threadPool() const
+{
+    return m_threadPool;
+}
+void QCborVariantWriter::setThreadPool(QThreadPool *pool)
+{
+    m_threadPool = pool;
+}
 void QCborVariantWriter::startArray()
 {
     m_device->startArray();
@@ -138,12 +427,19 @@ void QCborVariantWriter::writeRaw(const QByteArray &data)
 }
 void QCborVariantWriter::writeVariant(const QVariant &v)
 {
-    ::variantToCbor(v, *m_device, m_options);
+    ::variantToCborParallel(v, *m_device, m_options, m_threadPool);
 }
 
-QByteArray QCborVariantWriter::fromVariant(const QVariant& variant, int options)
+void QCborVariantWriter::writeGadget(const void *gadget, const QMetaObject *metaObject)
+{
+    ::gadgetToCbor(gadget, metaObject, *m_device, m_options);
+}
+
+QByteArray QCborVariantWriter::fromVariant(const QVariant& variant, int options, bool exactSize)
 {
     QByteArray cbor;
+    if (exactSize)
+        cbor.reserve(serializedSize(variant, options));
     QCborVariantWriter writer(&cbor, options);
 
     writer.start();
@@ -162,3 +458,31 @@ void QCborVariantWriter::fromVariant(const QVariant& variant, QIODevice* device,
     writer.writeVariant(variant);
 }
 
+
+QByteArray QCborVariantWriter::fromVariantParallel(const QVariant& variant, int options, QThreadPool* pool)
+{
+    QByteArray cbor;
+    QCborVariantWriter writer(&cbor, options);
+    writer.setThreadPool(pool ? pool : QThreadPool::globalInstance());
+
+    writer.start();
+    writer.writeVariant(variant);
+
+    cbor.squeeze();
+
+    return cbor;
+}
+
+void QCborVariantWriter::fromVariantParallel(const QVariant& variant, QIODevice* device, int options, QThreadPool* pool)
+{
+    QCborVariantWriter writer(device, options);
+    writer.setThreadPool(pool ? pool : QThreadPool::globalInstance());
+
+    writer.start();
+    writer.writeVariant(variant);
+}
+
+qsizetype QCborVariantWriter::serializedSize(const QVariant& variant, int options)
+{
+    return variantCborSize(variant, options);
+}
@@ -4,6 +4,9 @@
 #include <QVariant>
 #include <QByteArray>
 #include <QCborStreamWriter>
+#include <QMetaObject>
+
+class QThreadPool;
 
 class QCborVariantWriter
 {
@@ -14,6 +17,14 @@ public:
     Q_DISABLE_COPY(QCborVariantWriter)
 
     void start();
+
+    // Pool to split large lists and maps across; the bytes written do not
+    // change. Null, the default, writes on the calling thread only. Split
+    // values bypass the stream writer's item count, so use it for values
+    // written outside startArray() and startMap().
+    QThreadPool *threadPool() const;
+    void setThreadPool(QThreadPool *pool);
+
     void startArray();
     void startArray(quint64 count);
     void endArray();
@@ -29,13 +40,24 @@ public:
     void writeRaw(const QByteArray &ba);
     void writeVariant(const QVariant &v);
 
-    static QByteArray fromVariant(const QVariant& variant, int options = 0);
+    template<typename T>
+    void writeGadget(const T &gadget) { writeGadget(&gadget, &T::staticMetaObject); }
+    void writeGadget(const void *gadget, const QMetaObject *metaObject);
+
+    // exactSize allocates the result once, at its serializedSize().
+    static QByteArray fromVariant(const QVariant& variant, int options = 0, bool exactSize = false);
     static void fromVariant(const QVariant& variant, QIODevice* device, int options = 0);
+    static QByteArray fromVariantParallel(const QVariant& variant, int options = 0, QThreadPool* pool = nullptr);
+    static void fromVariantParallel(const QVariant& variant, QIODevice* device, int options = 0, QThreadPool* pool = nullptr);
+
+    // The number of bytes fromVariant() writes, without writing them.
+    static qsizetype serializedSize(const QVariant& variant, int options = 0);
 
 private:
     QCborStreamWriter *m_device;
 
     int m_options;
+    QThreadPool *m_threadPool;
 };
 
 #endif // QCBORVARIANTWRITER_H
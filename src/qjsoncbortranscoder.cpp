@@ -0,0 +1,358 @@
+#include "qjsoncbortranscoder.h"
+#include "qjsonvariantreader.h"
+#include "qjsonvariantwriter.h"
+#include "qcborvariantreader.h"
+#include <QCborStreamReader>
+#include <QCborStreamWriter>
+#include <QCborValue>
+#include <QIODevice>
+#include <limits>
+
+#include "qutf8.h"
+#include "qjsonoutput.h"
+#include "qjsonscanner.h"
+#include "qjsonnumber.h"
+
+static inline void doubleToJson(double value, QJsonOutput &output)
+{
+    if (qIsFinite(value))
+        output.writeNumber(value);
+    else
+        output.write("null", 4); // see QJsonVariantWriter
+}
+
+QJsonCborTranscoder::QJsonCborTranscoder(QJsonOutput &output, bool compact):
+    m_output(output),
+    m_compact(compact)
+{
+
+}
+
+void QJsonCborTranscoder::write(const char *data, qsizetype size)
+{
+    m_output.write(data, size);
+}
+
+void QJsonCborTranscoder::write(const QByteArray &data)
+{
+    m_output.write(data);
+}
+
+bool QJsonCborTranscoder::jsonValue(QJsonVariantReader &r, QCborStreamWriter &writer, int options)
+{
+    // the same moves as QVariantReader::read(), so errors match fromJson()
+    switch (r.type()) {
+    case QVariantReader::List:
+    case QVariantReader::Map: {
+        const bool isMap = r.type() == QVariantReader::Map;
+        r.enterContainer();
+        if (isMap)
+            writer.startMap();
+        else
+            writer.startArray();
+
+        while (!r.hasError() && r.hasNext()) {
+            if (isMap) {
+                bool keyOk;
+                if (*r.ptr == '"') {
+                    keyOk = jsonString(r, writer);
+                } else {
+                    const QString key = r.readKey();
+                    keyOk = !r.hasError();
+                    writer.append(key);
+                }
+                if (!keyOk) {
+                    // like readMap(), read the value anyway so the error
+                    // reported is the same
+                    jsonValue(r, writer, options);
+                    return false;
+                }
+            }
+            if (!jsonValue(r, writer, options))
+                return false;
+        }
+        if (r.hasError())
+            return false;
+        r.leaveContainer();
+        if (r.hasError())
+            return false;
+
+        if (isMap)
+            writer.endMap();
+        else
+            writer.endArray();
+        return true;
+    }
+    default:
+        break;
+    }
+
+    if (r.ptr < r.end && *r.ptr == '"')
+        return jsonString(r, writer);
+    if (r.ptr < r.end && (*r.ptr == '-' || QUtf8::isAsciiDigit(*r.ptr)))
+        return jsonNumber(r, writer, options);
+
+    // literals, and the errors for anything else
+    const QVariant value = r.readValue();
+    if (r.hasError())
+        return false;
+    if (value.metaType().id() == QMetaType::Bool)
+        writer.append(value.toBool());
+    else
+        writer.append(nullptr);
+    return true;
+}
+
+bool QJsonCborTranscoder::jsonString(QJsonVariantReader &r, QCborStreamWriter &writer)
+{
+    const char *start;
+    bool isUtf8;
+    if (!r.scanString(start, isUtf8))
+        return false;
+
+    // write before next(), which may slide the window away from start
+    const char *stop = r.ptr - 1; // exclude closing quote
+    if (isUtf8 && QUtf8::isValidUtf8(start, stop)) {
+        writer.appendTextString(start, stop - start);
+    } else if (isUtf8) {
+        writer.append(QString::fromUtf8(start, stop - start));
+    } else {
+        QUtf8::unescapedString(start, stop, r.m_stringBuffer);
+        writer.append(r.m_stringBuffer);
+    }
+    r.next();
+    return true;
+}
+
+bool QJsonCborTranscoder::jsonNumber(QJsonVariantReader &r, QCborStreamWriter &writer, int options)
+{
+    const char *start;
+    if (!r.scanNumber(start))
+        return false;
+
+    qint64 n;
+    double d;
+    switch (QJsonNumber::parse(start, r.ptr, &n, &d)) {
+    case QJsonNumber::Integer:
+        writer.append(n);
+        break;
+    case QJsonNumber::Double:
+        // through QCborValue, which applies the encoding options
+        QCborValue(d).toCbor(writer, (QCborValue::EncodingOptions)options);
+        break;
+    case QJsonNumber::Invalid:
+    default:
+        r.m_lastError = QJsonParseError::IllegalNumber;
+        return false;
+    }
+    r.next();
+    return true;
+}
+
+bool QJsonCborTranscoder::cborValue(QCborVariantReader &r, int indent)
+{
+    QCborStreamReader &s = *r.m_device;
+
+    // laid out the way QJsonVariantWriter lays out lists and maps
+    switch (s.type()) {
+    case QCborStreamReader::Array:
+    case QCborStreamReader::Map: {
+        const bool isMap = s.isMap();
+        if (!s.enterContainer())
+            return false;
+        if (isMap)
+            write(m_compact ? "{" : "{\n", m_compact ? 1 : 2);
+        else
+            write(m_compact ? "[" : "[\n", m_compact ? 1 : 2);
+
+        bool empty = true;
+        while (!r.hasError() && s.hasNext()) {
+            if (!empty)
+                write(m_compact ? "," : ",\n", m_compact ? 1 : 2);
+            empty = false;
+            m_output.writeIndent(m_compact ? 0 : indent + 1);
+
+            if (isMap) {
+                if (s.isString()) {
+                    if (!cborString(r, true))
+                        return false;
+                } else {
+                    // other keys are converted the way readMap() does
+                    const QString key = r.readKey();
+                    if (r.hasError())
+                        return false;
+                    write("\"", 1);
+                    m_output.writeEscaped(key);
+                    write("\"", 1);
+                }
+                write(m_compact ? ":" : ": ", m_compact ? 1 : 2);
+            }
+            if (!cborValue(r, indent + 1))
+                return false;
+        }
+        if (r.hasError() || !s.leaveContainer())
+            return false;
+
+        if (!empty && !m_compact)
+            write("\n", 1);
+        m_output.writeIndent(m_compact ? 0 : indent);
+        const char close = isMap ? '}' : ']';
+        write(&close, 1);
+        if (!m_compact && indent == 0)
+            write("\n", 1);
+        return true;
+    }
+    case QCborStreamReader::String:
+        return cborString(r, true);
+    case QCborStreamReader::ByteArray:
+        return cborString(r, false);
+    case QCborStreamReader::UnsignedInteger:
+        if (s.toUnsignedInteger() > quint64(std::numeric_limits<qint64>::max()))
+            return cborVariant(r, indent);
+        m_output.writeNumber(qint64(s.toUnsignedInteger()));
+        return s.next();
+    case QCborStreamReader::NegativeInteger: {
+        // the value is minus n
+        const quint64 n = quint64(s.toNegativeInteger());
+        if (n > quint64(std::numeric_limits<qint64>::max()) + 1)
+            return cborVariant(r, indent);
+        m_output.writeNumber(-qint64(n - 1) - 1);
+        return s.next();
+    }
+    case QCborStreamReader::Float16:
+        doubleToJson(double(s.toFloat16()), m_output);
+        return s.next();
+    case QCborStreamReader::Float:
+        doubleToJson(double(s.toFloat()), m_output);
+        return s.next();
+    case QCborStreamReader::Double:
+        doubleToJson(s.toDouble(), m_output);
+        return s.next();
+    case QCborStreamReader::SimpleType:
+        if (s.isFalse())
+            write("false", 5);
+        else if (s.isTrue())
+            write("true", 4);
+        else if (s.isNull() || s.isUndefined())
+            write("null", 4);
+        else
+            return cborVariant(r, indent);
+        return s.next();
+    case QCborStreamReader::Invalid:
+        return false;
+    default:
+        return cborVariant(r, indent);
+    }
+}
+
+bool QJsonCborTranscoder::cborString(QCborVariantReader &r, bool isText)
+{
+    const qint64 offset = r.currentOffset();
+    if (!r.readUtf8String())
+        return false;
+
+    const char *begin = r.m_stringBuffer.constData();
+    const char *end = begin + r.m_stringBuffer.size();
+    const bool isUtf8 = QUtf8::isValidUtf8(begin, end);
+
+    // text is refused like readAllString() refuses it, bytes are decoded
+    // like QVariant::toString() decodes them
+    if (isText && !isUtf8) {
+        // the chunks are read raw, so the stream has not flagged it
+        m_error.error = { QCborError::InvalidUtf8String };
+        m_error.offset = offset;
+        return false;
+    }
+
+    write("\"", 1);
+    if (isUtf8 && QJsonScanner::findStringSpecial(begin, end) == end)
+        write(begin, end - begin);
+    else
+        m_output.writeEscaped(QString::fromUtf8(r.m_stringBuffer));
+    write("\"", 1);
+    return true;
+}
+
+bool QJsonCborTranscoder::cborVariant(QCborVariantReader &r, int indent)
+{
+    // tags, big integers and other simple types are rare: convert them the
+    // way a full read does and shift the writer's output to this depth.
+    // JSON strings hold no raw newline, so each one is a layout line break.
+    const QVariant value = r.readValue();
+    if (r.hasError())
+        return false;
+
+    QByteArray json = QJsonVariantWriter::fromVariant(value, m_compact);
+    if (!m_compact && indent > 0) {
+        if (json.endsWith('\n'))
+            json.chop(1);
+        json.replace("\n", "\n" + QByteArray(4 * indent, ' '));
+    }
+    write(json);
+    return true;
+}
+
+bool QJsonCborTranscoder::cborResult(QCborVariantReader &reader, bool ok, QCborParserError *error) const
+{
+    // the stream stops at the failing element, so its error is the one to
+    // report, unless cborString() refused the text itself
+    const QCborParserError result = m_error.error != QCborError::NoError ? m_error : reader.error();
+    if(error)
+        *error = result;
+    return ok && result.error == QCborError::NoError;
+}
+
+QByteArray QJsonCborTranscoder::jsonToCbor(const QByteArray& json, int options, QJsonParseError* error)
+{
+    QByteArray cbor;
+    cbor.reserve(json.size() / 2);
+
+    QJsonVariantReader reader(json);
+    {
+        QCborStreamWriter writer(&cbor);
+        jsonValue(reader, writer, options);
+    }
+    if(error)
+        *error = reader.error();
+
+    cbor.squeeze();
+    return cbor;
+}
+
+bool QJsonCborTranscoder::jsonToCbor(QIODevice* json, QIODevice* cbor, int options, QJsonParseError* error)
+{
+    QJsonVariantReader reader(json);
+    QCborStreamWriter writer(cbor);
+    const bool ok = jsonValue(reader, writer, options);
+    if(error)
+        *error = reader.error();
+    return ok;
+}
+
+QByteArray QJsonCborTranscoder::cborToJson(const QByteArray& cbor, bool compact, QCborParserError* error)
+{
+    QByteArray json;
+    json.reserve(cbor.size() * 2);
+
+    QCborVariantReader reader(cbor);
+    {
+        QJsonOutput output(&json);
+        QJsonCborTranscoder transcoder(output, compact);
+        const bool ok = transcoder.cborValue(reader, 0);
+        transcoder.cborResult(reader, ok, error);
+    }
+
+    json.squeeze();
+    return json;
+}
+
+bool QJsonCborTranscoder::cborToJson(QIODevice* cbor, QIODevice* json, bool compact, QCborParserError* error)
+{
+    // files are mapped, other devices streamed: nothing holds the input whole
+    QCborVariantReader reader(cbor, true);
+    QJsonOutput output(json);
+    QJsonCborTranscoder transcoder(output, compact);
+    const bool ok = transcoder.cborValue(reader, 0);
+    output.flush();
+    return transcoder.cborResult(reader, ok, error);
+}
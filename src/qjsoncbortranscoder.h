@@ -0,0 +1,55 @@
+#ifndef QJSONCBORTRANSCODER_H
+#define QJSONCBORTRANSCODER_H
+
+#include <QByteArray>
+#include <QJsonParseError>
+#include <QCborParserError>
+
+class QIODevice;
+class QJsonOutput;
+class QCborStreamWriter;
+class QJsonVariantReader;
+class QCborVariantReader;
+
+// Converts between JSON and CBOR token by token, without building a
+// QVariant tree: memory stays proportional to the nesting depth. Device
+// input is read through a window (JSON) or QCborStreamReader (CBOR), files
+// straight from their mapping. A CBOR error is the one QCborStreamReader
+// reports at the failing element; invalid UTF-8 in a text string is
+// reported as InvalidUtf8String at the offset of the string.
+//
+// Values map the way QJsonVariantReader + QCborVariantWriter and
+// QCborVariantReader + QJsonVariantWriter map them. Maps keep their source
+// order, as with QVariantReader::VariantPairList, and JSON containers are
+// written as indefinite-length CBOR arrays and maps since their size is
+// not known up front.
+class QJsonCborTranscoder
+{
+public:
+    static QByteArray jsonToCbor(const QByteArray& json, int options = 0, QJsonParseError* error = nullptr);
+    static bool jsonToCbor(QIODevice* json, QIODevice* cbor, int options = 0, QJsonParseError* error = nullptr);
+
+    static QByteArray cborToJson(const QByteArray& cbor, bool compact = true, QCborParserError* error = nullptr);
+    static bool cborToJson(QIODevice* cbor, QIODevice* json, bool compact = true, QCborParserError* error = nullptr);
+
+private:
+    QJsonCborTranscoder(QJsonOutput &output, bool compact);
+
+    static bool jsonValue(QJsonVariantReader &reader, QCborStreamWriter &writer, int options);
+    static bool jsonString(QJsonVariantReader &reader, QCborStreamWriter &writer);
+    static bool jsonNumber(QJsonVariantReader &reader, QCborStreamWriter &writer, int options);
+
+    bool cborValue(QCborVariantReader &reader, int indent);
+    bool cborString(QCborVariantReader &reader, bool isText);
+    bool cborVariant(QCborVariantReader &reader, int indent);
+    bool cborResult(QCborVariantReader &reader, bool ok, QCborParserError *error) const;
+
+    inline void write(const char *data, qsizetype size);
+    inline void write(const QByteArray &data);
+
+    QJsonOutput &m_output;
+    bool m_compact;
+    QCborParserError m_error;
+};
+
+#endif // QJSONCBORTRANSCODER_H
@@ -0,0 +1,202 @@
+#include "qjsonformatter.h"
+#include "qjsonvariantreader.h"
+#include <QIODevice>
+
+#include "qutf8.h"
+#include "qjsonoutput.h"
+#include "qjsonscanner.h"
+#include "qjsonnumber.h"
+
+QJsonFormatter::QJsonFormatter(QJsonVariantReader &reader, QJsonOutput &output, bool compact):
+    m_reader(reader),
+    m_output(output),
+    m_compact(compact)
+{
+
+}
+
+void QJsonFormatter::write(const char *data, qsizetype size)
+{
+    m_output.write(data, size);
+}
+
+void QJsonFormatter::write(const QByteArray &data)
+{
+    m_output.write(data);
+}
+
+bool QJsonFormatter::formatValue(int indent)
+{
+    QJsonVariantReader &r = m_reader;
+
+    // the same moves as QVariantReader::read(), written out the way
+    // QJsonVariantWriter lays out lists and maps
+    switch (r.type()) {
+    case QVariantReader::List:
+    case QVariantReader::Map: {
+        const bool isMap = r.type() == QVariantReader::Map;
+        r.enterContainer();
+        if (isMap)
+            write(m_compact ? "{" : "{\n", m_compact ? 1 : 2);
+        else
+            write(m_compact ? "[" : "[\n", m_compact ? 1 : 2);
+
+        bool empty = true;
+        while (!r.hasError() && r.hasNext()) {
+            if (!empty)
+                write(m_compact ? "," : ",\n", m_compact ? 1 : 2);
+            empty = false;
+            m_output.writeIndent(m_compact ? 0 : indent + 1);
+
+            if (isMap) {
+                bool keyOk;
+                if (*r.ptr == '"') {
+                    keyOk = formatString();
+                } else {
+                    const QString key = r.readKey();
+                    keyOk = !r.hasError();
+                    write("\"", 1);
+                    m_output.writeEscaped(key);
+                    write("\"", 1);
+                }
+                if (!keyOk) {
+                    // like readMap(), read the value anyway so the error
+                    // reported is the same
+                    formatValue(indent + 1);
+                    return false;
+                }
+                write(m_compact ? ":" : ": ", m_compact ? 1 : 2);
+            }
+            if (!formatValue(indent + 1))
+                return false;
+        }
+        if (r.hasError())
+            return false;
+        r.leaveContainer();
+        if (r.hasError())
+            return false;
+
+        if (!empty && !m_compact)
+            write("\n", 1);
+        m_output.writeIndent(m_compact ? 0 : indent);
+        const char close = isMap ? '}' : ']';
+        write(&close, 1);
+        if (!m_compact && indent == 0)
+            write("\n", 1);
+        return true;
+    }
+    default:
+        break;
+    }
+
+    if (r.ptr < r.end && *r.ptr == '"')
+        return formatString();
+    if (r.ptr < r.end && (*r.ptr == '-' || QUtf8::isAsciiDigit(*r.ptr)))
+        return formatNumber();
+
+    // literals, and the errors for anything else
+    const QVariant value = r.readValue();
+    if (r.hasError())
+        return false;
+    if (value.metaType().id() == QMetaType::Bool)
+        value.toBool() ? write("true", 4) : write("false", 5);
+    else
+        write("null", 4);
+    return true;
+}
+
+bool QJsonFormatter::formatString()
+{
+    QJsonVariantReader &r = m_reader;
+
+    const char *start;
+    bool isUtf8;
+    if (!r.scanString(start, isUtf8))
+        return false;
+
+    // copy before next(), which may slide the window away from start
+    const char *stop = r.ptr - 1; // exclude closing quote
+    if (isUtf8 && QJsonScanner::findStringSpecial(start, stop) == stop && QUtf8::isValidUtf8(start, stop)) {
+        // already what the writer would produce
+        write(start - 1, stop - start + 2);
+    } else {
+        const QString string = isUtf8 ? QString::fromUtf8(start, stop - start)
+                                      : QUtf8::unescapedString(start, stop);
+        write("\"", 1);
+        m_output.writeEscaped(string);
+        write("\"", 1);
+    }
+    r.next();
+    return true;
+}
+
+bool QJsonFormatter::formatNumber()
+{
+    QJsonVariantReader &r = m_reader;
+
+    const char *start;
+    if (!r.scanNumber(start))
+        return false;
+
+    // plain integers that fit are printed back digit for digit, except -0
+    const char *digits = start + (*start == '-' ? 1 : 0);
+    const qsizetype length = r.ptr - digits;
+    bool verbatim = length > 0 && length <= 18 && !(length == 1 && *digits == '0' && digits != start);
+    for (const char *p = digits; verbatim && p < r.ptr; ++p)
+        verbatim = QUtf8::isAsciiDigit(*p);
+    if (verbatim) {
+        write(start, r.ptr - start);
+        r.next();
+        return true;
+    }
+
+    qint64 n;
+    double d;
+    switch (QJsonNumber::parse(start, r.ptr, &n, &d)) {
+    case QJsonNumber::Integer:
+        m_output.writeNumber(n);
+        break;
+    case QJsonNumber::Double:
+        if (qIsFinite(d))
+            m_output.writeNumber(d);
+        else
+            write("null", 4); // see QJsonVariantWriter
+        break;
+    case QJsonNumber::Invalid:
+    default:
+        r.m_lastError = QJsonParseError::IllegalNumber;
+        return false;
+    }
+    r.next();
+    return true;
+}
+
+QByteArray QJsonFormatter::format(const QByteArray& json, bool compact, QJsonParseError* error)
+{
+    QByteArray result;
+    result.reserve(json.size());
+
+    QJsonVariantReader reader(json);
+    {
+        QJsonOutput output(&result);
+        QJsonFormatter formatter(reader, output, compact);
+        formatter.formatValue(0);
+    }
+    if(error)
+        *error = reader.error();
+
+    result.squeeze();
+    return result;
+}
+
+bool QJsonFormatter::format(QIODevice* input, QIODevice* output, bool compact, QJsonParseError* error)
+{
+    QJsonVariantReader reader(input);
+    QJsonOutput buffer(output);
+    QJsonFormatter formatter(reader, buffer, compact);
+    const bool ok = formatter.formatValue(0);
+    buffer.flush();
+    if(error)
+        *error = reader.error();
+    return ok;
+}
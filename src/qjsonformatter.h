@@ -0,0 +1,38 @@
+#ifndef QJSONFORMATTER_H
+#define QJSONFORMATTER_H
+
+#include <QByteArray>
+#include <QJsonParseError>
+
+class QIODevice;
+class QJsonOutput;
+class QJsonVariantReader;
+
+// Rewrites JSON between compact and indented form without building a
+// QVariant tree. The layout is the one QJsonVariantWriter produces;
+// strings and numbers already in the writer's form are copied as they
+// are, the others are re-encoded the way the writer would encode them.
+// Object members keep their source order, as with
+// QVariantReader::VariantPairList.
+class QJsonFormatter
+{
+public:
+    static QByteArray format(const QByteArray& json, bool compact = true, QJsonParseError* error = nullptr);
+    static bool format(QIODevice* input, QIODevice* output, bool compact = true, QJsonParseError* error = nullptr);
+
+private:
+    QJsonFormatter(QJsonVariantReader &reader, QJsonOutput &output, bool compact);
+
+    bool formatValue(int indent);
+    bool formatString();
+    bool formatNumber();
+
+    inline void write(const char *data, qsizetype size);
+    inline void write(const QByteArray &data);
+
+    QJsonVariantReader &m_reader;
+    QJsonOutput &m_output;
+    bool m_compact;
+};
+
+#endif // QJSONFORMATTER_H
@@ -0,0 +1,36 @@
+#ifndef QJSONNUMBER_H
+#define QJSONNUMBER_H
+
+#include <QtGlobal>
+
+// Locale-free decoder and encoder for JSON number tokens.
+namespace QJsonNumber {
+
+enum Type : quint8 {
+    Invalid = 0,
+    Integer = 1,
+    Double = 2
+};
+
+// Decodes the number token [begin, end). Tokens without fraction or
+// exponent that fit in a qint64 are integers, everything else is a
+// correctly rounded double.
+Type parse(const char *begin, const char *end, qint64 *integer, double *number);
+
+// Room to leave for either formatter.
+enum { MaxFormattedLength = 32 };
+
+// Write value at out and return the end of what was written. Integers are
+// written as QByteArray::number() writes them; doubles as
+// QByteArray::number(value, 'g', QLocale::FloatingPointShortest) does,
+// from the shortest digits that read back to the same value.
+char *formatInteger(char *out, qint64 value);
+char *formatDouble(char *out, double value);
+
+// How many bytes the formatters write for value.
+int integerLength(qint64 value);
+int doubleLength(double value);
+
+} // namespace QJsonNumber
+
+#endif // QJSONNUMBER_H
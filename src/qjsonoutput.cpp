@@ -0,0 +1,138 @@
+#include "qjsonoutput.h"
+#include <QIODevice>
+
+#include "qutf8.h"
+
+QJsonOutput::QJsonOutput(QByteArray *data):
+    m_data(data),
+    m_device(nullptr),
+    m_flushSize(DefaultFlushSize),
+    m_indentWidth(4),
+    m_indentCharacter(' ')
+{
+    // like a QBuffer opened for writing, the array is overwritten; what
+    // the caller reserved is used before growing
+    m_data->resize(0);
+    m_data->resize(m_data->capacity());
+    m_begin = m_ptr = m_data->data();
+    m_end = m_begin + m_data->size();
+}
+
+QJsonOutput::QJsonOutput(QIODevice *device, qsizetype flushSize):
+    m_data(&m_buffer),
+    m_device(device),
+    m_flushSize(qMax<qsizetype>(flushSize, 1)),
+    m_indentWidth(4),
+    m_indentCharacter(' ')
+{
+    m_buffer.resize(m_flushSize);
+    m_begin = m_ptr = m_buffer.data();
+    m_end = m_begin + m_buffer.size();
+}
+
+QJsonOutput::~QJsonOutput()
+{
+    flush();
+}
+
+void QJsonOutput::setFlushSize(qsizetype size)
+{
+    m_flushSize = qMax<qsizetype>(size, 1);
+    if (m_device) {
+        flush();
+        m_buffer.resize(m_flushSize);
+        m_begin = m_ptr = m_buffer.data();
+        m_end = m_begin + m_buffer.size();
+    }
+}
+
+void QJsonOutput::setIndentation(int width, char character)
+{
+    // anything but JSON whitespace would break the output
+    Q_ASSERT_X(character == ' ' || character == '\t', "QJsonOutput::setIndentation",
+               "the indentation character must be a space or a tab");
+    m_indentWidth = qMax(width, 0);
+    m_indentCharacter = character == '\t' ? '\t' : ' ';
+}
+
+void QJsonOutput::writeIndent(int depth)
+{
+    static const char spaces[] = "                                                                "
+                                 "                                                                ";
+    static const char tabs[] = "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+
+    qsizetype count = qsizetype(depth) * m_indentWidth;
+    if (count <= 0)
+        return;
+
+    // slices of a static run
+    const bool isTab = m_indentCharacter == '\t';
+    const char *run = isTab ? tabs : spaces;
+    const qsizetype runSize = isTab ? sizeof(tabs) - 1 : sizeof(spaces) - 1;
+    while (count > 0) {
+        const qsizetype size = qMin(count, runSize);
+        write(run, size);
+        count -= size;
+    }
+}
+
+void QJsonOutput::writeEscaped(QStringView string)
+{
+    const char16_t *src = string.utf16();
+    const char16_t *const end = src + string.size();
+    while (src < end) {
+        const char16_t *stop = QUtf8::escapeChunkEnd(src, end);
+        if (m_end - m_ptr >= QUtf8::MaxEscapedUnitSize * (stop - src)) {
+            m_ptr = QUtf8::escapeString(src, stop, m_ptr);
+            src = stop;
+            continue;
+        }
+
+        // not enough room for the worst case: escape smaller pieces on the
+        // stack and copy what they actually take
+        char buffer[QUtf8::MaxEscapedUnitSize * 256];
+        while (src < stop) {
+            const char16_t *pieceEnd = QUtf8::escapeChunkEnd(src, stop, 256);
+            write(buffer, QUtf8::escapeString(src, pieceEnd, buffer) - buffer);
+            src = pieceEnd;
+        }
+    }
+}
+
+void QJsonOutput::grow(qsizetype size)
+{
+    if (m_device) {
+        // hand the pending bytes over and reuse the buffer from the start;
+        // it only outgrows the flush size for a single larger write
+        flush();
+        if (m_end - m_ptr < size) {
+            m_buffer.resize(size);
+            m_begin = m_ptr = m_buffer.data();
+            m_end = m_begin + m_buffer.size();
+        }
+        return;
+    }
+
+    const qsizetype used = m_ptr - m_begin;
+    const qsizetype capacity = qMax(qMax<qsizetype>(used + size, 2 * (m_end - m_begin)), 256);
+    m_data->resize(capacity);
+    m_begin = m_data->data();
+    m_ptr = m_begin + used;
+    m_end = m_begin + capacity;
+}
+
+void QJsonOutput::flush()
+{
+    const qsizetype used = m_ptr - m_begin;
+    if (m_device) {
+        if (used > 0)
+            m_device->write(m_begin, used);
+        m_ptr = m_begin;
+        return;
+    }
+
+    // give the array its final size; the next write grows it again
+    m_data->resize(used);
+    m_begin = m_data->data();
+    m_ptr = m_end = m_begin + used;
+}
@@ -0,0 +1,110 @@
+#ifndef QJSONOUTPUT_H
+#define QJSONOUTPUT_H
+
+#include <QByteArray>
+#include <QStringView>
+#include <cstring>
+
+#include "qjsonnumber.h"
+
+class QIODevice;
+
+// Contiguous output buffer for the JSON writers. Writing to a QByteArray
+// fills it in place, growing it geometrically; writing to a QIODevice
+// collects the bytes and hands them over flushSize bytes at a time.
+//
+// A QByteArray target holds spare capacity while writing and only has its
+// final size after flush(), which the destructor calls. Capacity the caller
+// reserved is used first: when it is exactly the size of the output, the
+// array is filled without being reallocated.
+class QJsonOutput
+{
+public:
+    enum { DefaultFlushSize = 64 * 1024 };
+
+    explicit QJsonOutput(QByteArray *data);
+    explicit QJsonOutput(QIODevice *device, qsizetype flushSize = DefaultFlushSize);
+    ~QJsonOutput();
+    Q_DISABLE_COPY(QJsonOutput)
+
+    QIODevice *device() const { return m_device; }
+
+    qsizetype flushSize() const { return m_flushSize; }
+    void setFlushSize(qsizetype size);
+
+    void write(char c)
+    {
+        if (m_ptr == m_end)
+            grow(1);
+        *m_ptr++ = c;
+    }
+    void write(const char *data, qsizetype size)
+    {
+        if (m_end - m_ptr < size)
+            grow(size);
+        ::memcpy(m_ptr, data, size);
+        m_ptr += size;
+    }
+    void write(const char *string) { write(string, qsizetype(::strlen(string))); }
+    void write(const QByteArray &data) { write(data.constData(), data.size()); }
+
+    // Formatted in place, with no temporary QByteArray. Close to the end of
+    // the buffer they go through the stack instead, so a buffer sized
+    // exactly for its contents is never grown.
+    void writeNumber(qint64 value)
+    {
+        if (m_end - m_ptr >= QJsonNumber::MaxFormattedLength) {
+            m_ptr = QJsonNumber::formatInteger(m_ptr, value);
+            return;
+        }
+        char buffer[QJsonNumber::MaxFormattedLength];
+        write(buffer, QJsonNumber::formatInteger(buffer, value) - buffer);
+    }
+    void writeNumber(double value)
+    {
+        if (m_end - m_ptr >= QJsonNumber::MaxFormattedLength) {
+            m_ptr = QJsonNumber::formatDouble(m_ptr, value);
+            return;
+        }
+        char buffer[QJsonNumber::MaxFormattedLength];
+        write(buffer, QJsonNumber::formatDouble(buffer, value) - buffer);
+    }
+
+    // depth levels of indentation, each indentWidth() indentCharacter()s;
+    // the character is a space or a tab, anything else is taken as a space
+    void writeIndent(int depth);
+
+    int indentWidth() const { return m_indentWidth; }
+    char indentCharacter() const { return m_indentCharacter; }
+    void setIndentation(int width, char character = ' ');
+
+    // The body of a JSON string, escaped in place; see QUtf8::escapeString().
+    void writeEscaped(QStringView string);
+
+    // Room for size bytes written in place; advance() past what was used.
+    char *reserve(qsizetype size)
+    {
+        if (m_end - m_ptr < size)
+            grow(size);
+        return m_ptr;
+    }
+    void advance(qsizetype size) { m_ptr += size; }
+
+    void flush();
+
+private:
+    void grow(qsizetype size);
+
+    QByteArray *m_data;
+    QIODevice *m_device;
+    QByteArray m_buffer;
+    qsizetype m_flushSize;
+    int m_indentWidth;
+    char m_indentCharacter;
+
+    char *m_begin;
+    char *m_ptr;
+    char *m_end;
+};
+
+#endif // QJSONOUTPUT_H
@@ -0,0 +1,594 @@
+#include "qjsonscanner.h"
+#include <QtCore/qalgorithms.h>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#  define QJSONSCANNER_X86
+#  include <immintrin.h>
+#  if defined(_MSC_VER) && !defined(__clang__)
+#    include <intrin.h>
+#    define QJSONSCANNER_TARGET_AVX2
+#  else
+#    define QJSONSCANNER_TARGET_AVX2 __attribute__((target("avx2")))
+#  endif
+#endif
+
+namespace {
+
+typedef const char *(*ScanFunction)(const char *, const char *);
+typedef void (*ClassifyFunction)(const char *, QJsonScanner::BlockMasks *);
+typedef qsizetype (*WidenFunction)(const char *, const char *, char16_t *);
+typedef qsizetype (*NarrowFunction)(const char16_t *, const char16_t *, char *);
+typedef qsizetype (*CountFunction)(const char16_t *, const char16_t *);
+
+inline bool isWhitespace(uchar c)
+{
+    return c == 0x20 || c == 0x09 || c == 0x0a || c == 0x0d;
+}
+
+inline bool isStringSpecial(uchar c)
+{
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+const char *skipWhitespaceScalar(const char *ptr, const char *end)
+{
+    while (ptr < end && isWhitespace(*ptr))
+        ++ptr;
+    return ptr;
+}
+
+const char *findStringSpecialScalar(const char *ptr, const char *end)
+{
+    while (ptr < end && !isStringSpecial(*ptr))
+        ++ptr;
+    return ptr;
+}
+
+inline bool isBracketOrQuote(uchar c)
+{
+    // '[' | 0x20 == '{' and ']' | 0x20 == '}'
+    return c == '"' || (c | 0x20) == '{' || (c | 0x20) == '}';
+}
+
+const char *findBracketOrQuoteScalar(const char *ptr, const char *end)
+{
+    while (ptr < end && !isBracketOrQuote(*ptr))
+        ++ptr;
+    return ptr;
+}
+
+const char *findStructuralScalar(const char *ptr, const char *end)
+{
+    while (ptr < end && *ptr != ',' && !isBracketOrQuote(*ptr))
+        ++ptr;
+    return ptr;
+}
+
+inline bool isStructural(uchar c)
+{
+    return c == ':' || c == ',' || (c | 0x20) == '{' || (c | 0x20) == '}';
+}
+
+void classifyBlockScalar(const char *ptr, QJsonScanner::BlockMasks *masks)
+{
+    quint64 backslash = 0, quote = 0, structural = 0, whitespace = 0;
+    for (int i = 0; i < 64; ++i) {
+        const uchar c = ptr[i];
+        const quint64 bit = quint64(1) << i;
+        if (c == '\\')
+            backslash |= bit;
+        else if (c == '"')
+            quote |= bit;
+        else if (isStructural(c))
+            structural |= bit;
+        else if (isWhitespace(c))
+            whitespace |= bit;
+    }
+    *masks = { backslash, quote, structural, whitespace };
+}
+
+qsizetype widenAsciiScalar(const char *src, const char *end, char16_t *dst)
+{
+    const char *begin = src;
+    while (src < end && uchar(*src) < 0x80 && *src != '\\')
+        *dst++ = uchar(*src++);
+    return src - begin;
+}
+
+qsizetype narrowAsciiScalar(const char16_t *src, const char16_t *end, char *dst)
+{
+    const char16_t *begin = src;
+    while (src < end && *src >= 0x20 && *src < 0x80 && *src != '"' && *src != '\\')
+        *dst++ = char(*src++);
+    return src - begin;
+}
+
+qsizetype countAsciiScalar(const char16_t *src, const char16_t *end)
+{
+    const char16_t *begin = src;
+    while (src < end && *src >= 0x20 && *src < 0x80 && *src != '"' && *src != '\\')
+        ++src;
+    return src - begin;
+}
+
+#ifdef QJSONSCANNER_X86
+const char *skipWhitespaceSse2(const char *ptr, const char *end)
+{
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i tab = _mm_set1_epi8(0x09);
+    const __m128i lineFeed = _mm_set1_epi8(0x0a);
+    const __m128i carriageReturn = _mm_set1_epi8(0x0d);
+
+    while (end - ptr >= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+        const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(v, lineFeed), _mm_cmpeq_epi8(v, carriageReturn)));
+        const uint mask = ~uint(_mm_movemask_epi8(ws)) & 0xffff;
+        if (mask)
+            return ptr + qCountTrailingZeroBits(mask);
+        ptr += 16;
+    }
+    return skipWhitespaceScalar(ptr, end);
+}
+
+const char *findStringSpecialSse2(const char *ptr, const char *end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+
+    while (end - ptr >= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+        // unsigned v <= 0x1f  <=>  min(v, 0x1f) == v
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                             _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        const uint mask = uint(_mm_movemask_epi8(special));
+        if (mask)
+            return ptr + qCountTrailingZeroBits(mask);
+        ptr += 16;
+    }
+    return findStringSpecialScalar(ptr, end);
+}
+
+const char *findBracketOrQuoteSse2(const char *ptr, const char *end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i openBrace = _mm_set1_epi8('{');
+    const __m128i closeBrace = _mm_set1_epi8('}');
+
+    while (end - ptr >= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+        const __m128i folded = _mm_or_si128(v, caseBit);
+        const __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                         _mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace)));
+        const uint mask = uint(_mm_movemask_epi8(hit));
+        if (mask)
+            return ptr + qCountTrailingZeroBits(mask);
+        ptr += 16;
+    }
+    return findBracketOrQuoteScalar(ptr, end);
+}
+
+const char *findStructuralSse2(const char *ptr, const char *end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i openBrace = _mm_set1_epi8('{');
+    const __m128i closeBrace = _mm_set1_epi8('}');
+
+    while (end - ptr >= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr));
+        const __m128i folded = _mm_or_si128(v, caseBit);
+        const __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, comma)),
+                                         _mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace)));
+        const uint mask = uint(_mm_movemask_epi8(hit));
+        if (mask)
+            return ptr + qCountTrailingZeroBits(mask);
+        ptr += 16;
+    }
+    return findStructuralScalar(ptr, end);
+}
+
+void classifyBlockSse2(const char *ptr, QJsonScanner::BlockMasks *masks)
+{
+    const __m128i backslashChar = _mm_set1_epi8('\\');
+    const __m128i quoteChar = _mm_set1_epi8('"');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+    const __m128i openBrace = _mm_set1_epi8('{');
+    const __m128i closeBrace = _mm_set1_epi8('}');
+    const __m128i colon = _mm_set1_epi8(':');
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i space = _mm_set1_epi8(0x20);
+    const __m128i tab = _mm_set1_epi8(0x09);
+    const __m128i lineFeed = _mm_set1_epi8(0x0a);
+    const __m128i carriageReturn = _mm_set1_epi8(0x0d);
+
+    quint64 backslash = 0, quote = 0, structural = 0, whitespace = 0;
+    for (int i = 0; i < 64; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(ptr + i));
+        const __m128i folded = _mm_or_si128(v, caseBit);
+        const __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, openBrace), _mm_cmpeq_epi8(folded, closeBrace)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(v, colon), _mm_cmpeq_epi8(v, comma)));
+        const __m128i ws = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, space), _mm_cmpeq_epi8(v, tab)),
+                                        _mm_or_si128(_mm_cmpeq_epi8(v, lineFeed), _mm_cmpeq_epi8(v, carriageReturn)));
+        backslash |= quint64(uint(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslashChar)))) << i;
+        quote |= quint64(uint(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quoteChar)))) << i;
+        structural |= quint64(uint(_mm_movemask_epi8(op))) << i;
+        whitespace |= quint64(uint(_mm_movemask_epi8(ws))) << i;
+    }
+    *masks = { backslash, quote, structural, whitespace };
+}
+
+qsizetype widenAsciiSse2(const char *src, const char *end, char16_t *dst)
+{
+    const char *begin = src;
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    while (end - src >= 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+        // store all 16 units, the caller guarantees the room for them
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi8(v, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 8), _mm_unpackhi_epi8(v, zero));
+        const uint mask = uint(_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, backslash))));
+        if (mask)
+            return src - begin + qCountTrailingZeroBits(mask);
+        src += 16;
+        dst += 16;
+    }
+    return src - begin + widenAsciiScalar(src, end, dst);
+}
+
+qsizetype narrowAsciiSse2(const char16_t *src, const char16_t *end, char *dst)
+{
+    const char16_t *begin = src;
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+
+    while (end - src >= 16) {
+        // units from 0x100 saturate to 0xff and units from 0x8000, negative
+        // as signed, to 0: both are flagged below like the byte they became
+        const __m128i v = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 8)));
+        // store all 16 bytes, the caller guarantees the room for them
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), v);
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                             _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        const uint mask = uint(_mm_movemask_epi8(_mm_or_si128(v, special)));
+        if (mask)
+            return src - begin + qCountTrailingZeroBits(mask);
+        src += 16;
+        dst += 16;
+    }
+    return src - begin + narrowAsciiScalar(src, end, dst);
+}
+
+qsizetype countAsciiSse2(const char16_t *src, const char16_t *end)
+{
+    const char16_t *begin = src;
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+
+    // narrowAsciiSse2() without the store
+    while (end - src >= 16) {
+        const __m128i v = _mm_packus_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 8)));
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+                                             _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        const uint mask = uint(_mm_movemask_epi8(_mm_or_si128(v, special)));
+        if (mask)
+            return src - begin + qCountTrailingZeroBits(mask);
+        src += 16;
+    }
+    return src - begin + countAsciiScalar(src, end);
+}
+
+QJSONSCANNER_TARGET_AVX2
+const char *skipWhitespaceAvx2(const char *ptr, const char *end)
+{
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i tab = _mm256_set1_epi8(0x09);
+    const __m256i lineFeed = _mm256_set1_epi8(0x0a);
+    const __m256i carriageReturn = _mm256_set1_epi8(0x0d);
+
+    while (end - ptr >= 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+        const __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+                                           _mm256_or_si256(_mm256_cmpeq_epi8(v, lineFeed), _mm256_cmpeq_epi8(v, carriageReturn)));
+        const uint mask = ~uint(_mm256_movemask_epi8(ws));
+        if (mask)
+            return ptr + qCountTrailingZeroBits(mask);
+        ptr += 32;
+    }
+    return skipWhitespaceSse2(ptr, end);
+}
+
+QJSONSCANNER_TARGET_AVX2
+const char *findStringSpecialAvx2(const char *ptr, const char *end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+
+    while (end - ptr >= 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+        const __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                                _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+        const uint mask = uint(_mm256_movemask_epi8(special));
+        if (mask)
+            return ptr + qCountTrailingZeroBits(mask);
+        ptr += 32;
+    }
+    return findStringSpecialSse2(ptr, end);
+}
+
+QJSONSCANNER_TARGET_AVX2
+const char *findBracketOrQuoteAvx2(const char *ptr, const char *end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i openBrace = _mm256_set1_epi8('{');
+    const __m256i closeBrace = _mm256_set1_epi8('}');
+
+    while (end - ptr >= 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+        const __m256i folded = _mm256_or_si256(v, caseBit);
+        const __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                                            _mm256_or_si256(_mm256_cmpeq_epi8(folded, openBrace), _mm256_cmpeq_epi8(folded, closeBrace)));
+        const uint mask = uint(_mm256_movemask_epi8(hit));
+        if (mask)
+            return ptr + qCountTrailingZeroBits(mask);
+        ptr += 32;
+    }
+    return findBracketOrQuoteSse2(ptr, end);
+}
+
+QJSONSCANNER_TARGET_AVX2
+const char *findStructuralAvx2(const char *ptr, const char *end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i openBrace = _mm256_set1_epi8('{');
+    const __m256i closeBrace = _mm256_set1_epi8('}');
+
+    while (end - ptr >= 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr));
+        const __m256i folded = _mm256_or_si256(v, caseBit);
+        const __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, comma)),
+                                            _mm256_or_si256(_mm256_cmpeq_epi8(folded, openBrace), _mm256_cmpeq_epi8(folded, closeBrace)));
+        const uint mask = uint(_mm256_movemask_epi8(hit));
+        if (mask)
+            return ptr + qCountTrailingZeroBits(mask);
+        ptr += 32;
+    }
+    return findStructuralSse2(ptr, end);
+}
+
+QJSONSCANNER_TARGET_AVX2
+void classifyBlockAvx2(const char *ptr, QJsonScanner::BlockMasks *masks)
+{
+    const __m256i backslashChar = _mm256_set1_epi8('\\');
+    const __m256i quoteChar = _mm256_set1_epi8('"');
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+    const __m256i openBrace = _mm256_set1_epi8('{');
+    const __m256i closeBrace = _mm256_set1_epi8('}');
+    const __m256i colon = _mm256_set1_epi8(':');
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i space = _mm256_set1_epi8(0x20);
+    const __m256i tab = _mm256_set1_epi8(0x09);
+    const __m256i lineFeed = _mm256_set1_epi8(0x0a);
+    const __m256i carriageReturn = _mm256_set1_epi8(0x0d);
+
+    quint64 backslash = 0, quote = 0, structural = 0, whitespace = 0;
+    for (int i = 0; i < 64; i += 32) {
+        const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ptr + i));
+        const __m256i folded = _mm256_or_si256(v, caseBit);
+        const __m256i op = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(folded, openBrace), _mm256_cmpeq_epi8(folded, closeBrace)),
+                                           _mm256_or_si256(_mm256_cmpeq_epi8(v, colon), _mm256_cmpeq_epi8(v, comma)));
+        const __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, space), _mm256_cmpeq_epi8(v, tab)),
+                                           _mm256_or_si256(_mm256_cmpeq_epi8(v, lineFeed), _mm256_cmpeq_epi8(v, carriageReturn)));
+        backslash |= quint64(uint(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslashChar)))) << i;
+        quote |= quint64(uint(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quoteChar)))) << i;
+        structural |= quint64(uint(_mm256_movemask_epi8(op))) << i;
+        whitespace |= quint64(uint(_mm256_movemask_epi8(ws))) << i;
+    }
+    *masks = { backslash, quote, structural, whitespace };
+}
+
+QJSONSCANNER_TARGET_AVX2
+qsizetype narrowAsciiAvx2(const char16_t *src, const char16_t *end, char *dst)
+{
+    const char16_t *begin = src;
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+
+    while (end - src >= 32) {
+        // packing works within 128-bit lanes, put the quadwords back in order
+        const __m256i packed = _mm256_packus_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)),
+                                                   _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 16)));
+        const __m256i v = _mm256_permute4x64_epi64(packed, 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), v);
+        const __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                                _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+        const uint mask = uint(_mm256_movemask_epi8(_mm256_or_si256(v, special)));
+        if (mask)
+            return src - begin + qCountTrailingZeroBits(mask);
+        src += 32;
+        dst += 32;
+    }
+    return src - begin + narrowAsciiSse2(src, end, dst);
+}
+
+QJSONSCANNER_TARGET_AVX2
+qsizetype countAsciiAvx2(const char16_t *src, const char16_t *end)
+{
+    const char16_t *begin = src;
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+
+    // narrowAsciiAvx2() without the store
+    while (end - src >= 32) {
+        const __m256i packed = _mm256_packus_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(src)),
+                                                   _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + 16)));
+        const __m256i v = _mm256_permute4x64_epi64(packed, 0xd8);
+        const __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+                                                _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+        const uint mask = uint(_mm256_movemask_epi8(_mm256_or_si256(v, special)));
+        if (mask)
+            return src - begin + qCountTrailingZeroBits(mask);
+        src += 32;
+    }
+    return src - begin + countAsciiSse2(src, end);
+}
+
+bool cpuHasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then check the OS saves the YMM registers
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0)
+        return false;
+    if ((_xgetbv(0) & 0x6) != 0x6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif // QJSONSCANNER_X86
+
+struct Kernels
+{
+    QJsonScanner::KernelSet set;
+    ScanFunction skipWhitespace;
+    ScanFunction findStringSpecial;
+    ScanFunction findBracketOrQuote;
+    ScanFunction findStructural;
+    ClassifyFunction classifyBlock;
+    WidenFunction widenAscii;
+    NarrowFunction narrowAscii;
+    CountFunction countAscii;
+};
+
+bool isSupported(QJsonScanner::KernelSet set)
+{
+    switch (set) {
+    case QJsonScanner::ScalarKernels:
+        return true;
+#ifdef QJSONSCANNER_X86
+    // SSE2 is part of the x86-64 baseline
+    case QJsonScanner::Sse2Kernels:
+        return true;
+    case QJsonScanner::Avx2Kernels:
+        return cpuHasAvx2();
+#endif
+    default:
+        return false;
+    }
+}
+
+Kernels kernelsFor(QJsonScanner::KernelSet set)
+{
+    switch (set) {
+#ifdef QJSONSCANNER_X86
+    case QJsonScanner::Avx2Kernels:
+        // widening is no faster with wider vectors
+        return { set, skipWhitespaceAvx2, findStringSpecialAvx2, findBracketOrQuoteAvx2, findStructuralAvx2, classifyBlockAvx2, widenAsciiSse2, narrowAsciiAvx2, countAsciiAvx2 };
+    case QJsonScanner::Sse2Kernels:
+        return { set, skipWhitespaceSse2, findStringSpecialSse2, findBracketOrQuoteSse2, findStructuralSse2, classifyBlockSse2, widenAsciiSse2, narrowAsciiSse2, countAsciiSse2 };
+#endif
+    default:
+        return { QJsonScanner::ScalarKernels, skipWhitespaceScalar, findStringSpecialScalar, findBracketOrQuoteScalar, findStructuralScalar, classifyBlockScalar, widenAsciiScalar, narrowAsciiScalar, countAsciiScalar };
+    }
+}
+
+Kernels selectKernels()
+{
+    if (isSupported(QJsonScanner::Avx2Kernels))
+        return kernelsFor(QJsonScanner::Avx2Kernels);
+    if (isSupported(QJsonScanner::Sse2Kernels))
+        return kernelsFor(QJsonScanner::Sse2Kernels);
+    return kernelsFor(QJsonScanner::ScalarKernels);
+}
+
+Kernels &kernels()
+{
+    static Kernels k = selectKernels();
+    return k;
+}
+
+} // namespace
+
+namespace QJsonScanner {
+
+const char *skipWhitespace(const char *ptr, const char *end)
+{
+    // most runs are empty or a single separator space, so look at the
+    // first byte before paying for the vector setup
+    if (ptr == end || !isWhitespace(*ptr))
+        return ptr;
+    return kernels().skipWhitespace(ptr + 1, end);
+}
+
+const char *findStringSpecial(const char *ptr, const char *end)
+{
+    return kernels().findStringSpecial(ptr, end);
+}
+
+const char *findBracketOrQuote(const char *ptr, const char *end)
+{
+    return kernels().findBracketOrQuote(ptr, end);
+}
+
+const char *findStructural(const char *ptr, const char *end)
+{
+    return kernels().findStructural(ptr, end);
+}
+
+void classifyBlock(const char *ptr, BlockMasks *masks)
+{
+    kernels().classifyBlock(ptr, masks);
+}
+
+qsizetype widenAscii(const char *src, const char *end, char16_t *dst)
+{
+    return kernels().widenAscii(src, end, dst);
+}
+
+qsizetype narrowAscii(const char16_t *src, const char16_t *end, char *dst)
+{
+    return kernels().narrowAscii(src, end, dst);
+}
+
+qsizetype countAscii(const char16_t *src, const char16_t *end)
+{
+    return kernels().countAscii(src, end);
+}
+
+KernelSet kernelSet()
+{
+    return kernels().set;
+}
+
+bool setKernelSet(KernelSet set)
+{
+    if (!isSupported(set))
+        return false;
+    kernels() = kernelsFor(set);
+    return true;
+}
+
+} // namespace QJsonScanner
@@ -0,0 +1,64 @@
+#ifndef QJSONSCANNER_H
+#define QJSONSCANNER_H
+
+#include <QtGlobal>
+
+// Byte scanning kernels for the JSON reader. Each kernel has a scalar,
+// an SSE2 and an AVX2 variant; the widest one the CPU supports is picked
+// once at runtime.
+namespace QJsonScanner {
+
+// Returns the first byte of [ptr, end) that is not JSON whitespace, or end.
+const char *skipWhitespace(const char *ptr, const char *end);
+
+// Returns the first '"', '\\' or control character of [ptr, end), or end.
+const char *findStringSpecial(const char *ptr, const char *end);
+
+// Returns the first '"', '[', ']', '{' or '}' of [ptr, end), or end.
+const char *findBracketOrQuote(const char *ptr, const char *end);
+
+// Returns the first '"', ',', '[', ']', '{' or '}' of [ptr, end), or end.
+const char *findStructural(const char *ptr, const char *end);
+
+// Bitmasks of one 64-byte block, bit i standing for byte i.
+struct BlockMasks
+{
+    quint64 backslash;
+    quint64 quote;
+    quint64 structural;     // '[', ']', '{', '}', ':' and ','
+    quint64 whitespace;
+};
+
+// Classifies the 64 bytes at ptr.
+void classifyBlock(const char *ptr, BlockMasks *masks);
+
+// Widens the bytes of [src, end) into dst up to the first backslash or
+// non-ASCII byte and returns how many were copied. dst must have room for
+// end - src units.
+qsizetype widenAscii(const char *src, const char *end, char16_t *dst);
+
+// Narrows the units of [src, end) into dst up to the first one that is not
+// ASCII or that JSON escapes, and returns how many were copied. dst must
+// have room for end - src bytes.
+qsizetype narrowAscii(const char16_t *src, const char16_t *end, char *dst);
+
+// How many units narrowAscii() would copy.
+qsizetype countAscii(const char16_t *src, const char16_t *end);
+
+enum KernelSet : quint8 {
+    ScalarKernels = 0,
+    Sse2Kernels = 1,
+    Avx2Kernels = 2
+};
+
+// The kernel set in use, the widest one the CPU supports unless forced.
+KernelSet kernelSet();
+
+// Forces a kernel set so tests can pin the variants against each other;
+// returns false, changing nothing, when this build or CPU lacks it. Not to
+// be called while other threads are scanning.
+bool setKernelSet(KernelSet set);
+
+} // namespace QJsonScanner
+
+#endif // QJSONSCANNER_H
@@ -0,0 +1,262 @@
+#include "qjsonstructuralindex.h"
+#include <cstring>
+#include <limits>
+
+#include "qutf8.h"
+#include "qjsonscanner.h"
+#include "qjsonnumber.h"
+
+namespace {
+
+// Every bit set in the result has an odd-length run of backslashes right
+// before it, i.e. is escaped. prevEscaped carries a run across blocks.
+inline quint64 findEscaped(quint64 backslash, quint64 &prevEscaped)
+{
+    const quint64 evenBits = 0x5555555555555555ULL;
+
+    backslash &= ~prevEscaped;
+    const quint64 followsEscape = (backslash << 1) | prevEscaped;
+
+    // adding the run starts to the runs carries out of the runs that
+    // start on odd bits, which flips them onto the even bit mask
+    const quint64 oddSequenceStarts = backslash & ~evenBits & ~followsEscape;
+    const quint64 sequencesStartingOnEvenBits = oddSequenceStarts + backslash;
+    prevEscaped = sequencesStartingOnEvenBits < backslash ? 1 : 0;
+
+    const quint64 invertMask = sequencesStartingOnEvenBits << 1;
+    return (evenBits ^ invertMask) & followsEscape;
+}
+
+// Bit i of the result is the parity of bits 0..i of x.
+inline quint64 prefixXor(quint64 x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+inline bool isWhitespace(char c)
+{
+    return c == 0x20 || c == 0x09 || c == 0x0a || c == 0x0d;
+}
+
+struct Walker
+{
+    const char *json;
+    const char *end;
+    const quint32 *pos;
+    const quint32 *last;
+
+    char current() const { return pos < last ? json[*pos] : 0; }
+
+    bool value(QVariant *out);
+    bool string(QString *out);
+    bool scalar(QVariant *out);
+};
+
+bool Walker::value(QVariant *out)
+{
+    switch (current()) {
+    case '{': {
+        ++pos;
+        QVariantMap map;
+        if (current() == '}') {
+            ++pos;
+            *out = map;
+            return true;
+        }
+        while (true) {
+            QString key;
+            if (current() != '"' || !string(&key))
+                return false;
+            if (current() != ':')
+                return false;
+            ++pos;
+            QVariant element;
+            if (!value(&element))
+                return false;
+            map.insert(std::move(key), std::move(element));
+
+            const char c = current();
+            ++pos;
+            if (c == '}')
+                break;
+            if (c != ',')
+                return false;
+        }
+        *out = map;
+        return true;
+    }
+    case '[': {
+        ++pos;
+        QVariantList list;
+        if (current() == ']') {
+            ++pos;
+            *out = list;
+            return true;
+        }
+        while (true) {
+            QVariant element;
+            if (!value(&element))
+                return false;
+            list.append(std::move(element));
+
+            const char c = current();
+            ++pos;
+            if (c == ']')
+                break;
+            if (c != ',')
+                return false;
+        }
+        list.squeeze();
+        *out = list;
+        return true;
+    }
+    case '"': {
+        QString s;
+        if (!string(&s))
+            return false;
+        *out = s;
+        return true;
+    }
+    case 0:
+    case '}':
+    case ']':
+    case ':':
+    case ',':
+        return false;
+    default:
+        return scalar(out);
+    }
+}
+
+bool Walker::string(QString *out)
+{
+    // the closing quote is not indexed, find it the way the reader does
+    const char *start = json + *pos + 1;
+    const char *ptr = start;
+    bool isUtf8 = true;
+    while (true) {
+        ptr = QJsonScanner::findStringSpecial(ptr, end);
+        if (ptr >= end)
+            return false;
+        if (*ptr == '"')
+            break;
+        if (*ptr == '\\') {
+            ++ptr;
+            isUtf8 = false;
+        }
+        ++ptr;
+    }
+
+    ++pos;
+    if (pos < last && json + *pos <= ptr)
+        return false;
+
+    *out = isUtf8 ? QString::fromUtf8(start, ptr - start)
+                  : QUtf8::unescapedString(start, ptr);
+    return true;
+}
+
+bool Walker::scalar(QVariant *out)
+{
+    // a scalar runs up to the next indexed position, minus whitespace
+    const char *start = json + *pos;
+    const char *stop = pos + 1 < last ? json + pos[1] : end;
+    while (stop > start && isWhitespace(stop[-1]))
+        --stop;
+    ++pos;
+
+    const qsizetype length = stop - start;
+    if (length == 4 && ::memcmp(start, "null", 4) == 0) {
+        *out = QVariant::fromValue(nullptr);
+        return true;
+    }
+    if (length == 4 && ::memcmp(start, "true", 4) == 0) {
+        *out = QVariant(true);
+        return true;
+    }
+    if (length == 5 && ::memcmp(start, "false", 5) == 0) {
+        *out = QVariant(false);
+        return true;
+    }
+
+    qint64 n;
+    double d;
+    switch (QJsonNumber::parse(start, stop, &n, &d)) {
+    case QJsonNumber::Integer:
+        *out = QVariant(qlonglong(n));
+        return true;
+    case QJsonNumber::Double:
+        *out = QVariant(d);
+        return true;
+    case QJsonNumber::Invalid:
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+bool QJsonStructuralIndex::build(const char *begin, const char *end)
+{
+    m_begin = begin;
+    m_end = end;
+    m_positions.clear();
+
+    const qsizetype size = end - begin;
+    if (size > qsizetype(std::numeric_limits<quint32>::max()))
+        return false;
+    m_positions.reserve(size / 8 + 16);
+
+    quint64 prevEscaped = 0;
+    quint64 prevInString = 0;
+    quint64 prevScalar = 0;
+    QJsonScanner::BlockMasks masks;
+    char tail[64];
+    for (qsizetype offset = 0; offset < size; offset += 64) {
+        const char *block = begin + offset;
+        if (size - offset < 64) {
+            // pad the last block with spaces, which never start a token
+            ::memset(tail, ' ', sizeof(tail));
+            ::memcpy(tail, block, size - offset);
+            block = tail;
+        }
+        QJsonScanner::classifyBlock(block, &masks);
+
+        const quint64 escaped = findEscaped(masks.backslash, prevEscaped);
+        const quint64 quote = masks.quote & ~escaped;
+
+        // set from an opening quote up to, not including, its closing quote
+        const quint64 inString = prefixXor(quote) ^ prevInString;
+        prevInString = quint64(qint64(inString) >> 63);
+        const quint64 stringTail = inString ^ quote;
+
+        // a scalar starts at any other byte that does not follow one; a
+        // quote never continues a scalar, so strings start there as well
+        const quint64 scalar = ~(masks.structural | masks.whitespace);
+        const quint64 nonQuoteScalar = scalar & ~quote;
+        const quint64 followsScalar = (nonQuoteScalar << 1) | prevScalar;
+        prevScalar = nonQuoteScalar >> 63;
+        const quint64 scalarStart = scalar & ~followsScalar;
+
+        quint64 bits = (masks.structural | scalarStart) & ~stringTail;
+        while (bits) {
+            m_positions.append(quint32(offset + qCountTrailingZeroBits(bits)));
+            bits &= bits - 1;
+        }
+    }
+
+    // an unterminated string swallowed the rest of the input
+    return prevInString == 0;
+}
+
+bool QJsonStructuralIndex::parse(QVariant *value) const
+{
+    Walker walker { m_begin, m_end, m_positions.constData(), m_positions.constData() + m_positions.size() };
+    return walker.value(value) && walker.pos == walker.last;
+}
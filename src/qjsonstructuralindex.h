@@ -0,0 +1,29 @@
+#ifndef QJSONSTRUCTURALINDEX_H
+#define QJSONSTRUCTURALINDEX_H
+
+#include <QList>
+#include <QVariant>
+
+// Two-stage JSON parser. Stage one classifies the input 64 bytes at a time
+// into bitmasks and records the offset of every structural character
+// outside strings, plus the first byte of every string and scalar. Stage
+// two walks those offsets to build the QVariant tree without looking at
+// whitespace again.
+//
+// Only strict JSON is accepted: parse() fails on anything the grammar does
+// not allow, and leaves error reporting to QJsonVariantReader.
+class QJsonStructuralIndex
+{
+public:
+    bool build(const char *begin, const char *end);
+    bool parse(QVariant *value) const;
+
+    const QList<quint32> &positions() const { return m_positions; }
+
+private:
+    const char *m_begin = nullptr;
+    const char *m_end = nullptr;
+    QList<quint32> m_positions;
+};
+
+#endif // QJSONSTRUCTURALINDEX_H
@@ -0,0 +1,208 @@
+#include "qjsonvariantlinesreader.h"
+#include "qjsonvariantreader.h"
+#include <QIODevice>
+#include <QThread>
+#include <QThreadPool>
+#include <QSemaphore>
+#include <cstring>
+
+struct QJsonVariantLinesReader::Batch
+{
+    void parse();
+
+    QByteArray data;
+    qint64 offset = 0;
+    QVariantReader::ReadOptions options;
+    QVariantReader::MapType mapType = QVariantReader::VariantMap;
+
+    QVariantList values;
+    QJsonParseError::ParseError error = QJsonParseError::NoError;
+    qint64 errorOffset = 0;
+
+    QSemaphore done;
+};
+
+void QJsonVariantLinesReader::Batch::parse()
+{
+    // one reader for the whole batch: records are separated by whitespace,
+    // which QJsonVariantReader::next() already skips
+    QJsonVariantReader reader(data);
+    reader.setReadOptions(options);
+    reader.setMapType(mapType);
+
+    while (!reader.atEnd()) {
+        QVariant value = reader.read();
+        if (reader.hasError()) {
+            error = reader.lastError();
+            errorOffset = offset + reader.currentOffset();
+            break;
+        }
+        values.append(value);
+    }
+}
+
+QJsonVariantLinesReader::QJsonVariantLinesReader(QIODevice *device):
+    m_lastError(QJsonParseError::NoError),
+    m_errorOffset(0),
+    m_threadPool(nullptr),
+    m_batchSize(DefaultBatchSize),
+    m_maxPendingBatches(2 * QThread::idealThreadCount()),
+    m_mapType(QVariantReader::VariantMap),
+    m_device(device),
+    m_position(0),
+    m_consumed(0),
+    m_inputEnd(false)
+{
+
+}
+
+QJsonVariantLinesReader::QJsonVariantLinesReader(const QByteArray &data):
+    m_lastError(QJsonParseError::NoError),
+    m_errorOffset(0),
+    m_threadPool(nullptr),
+    m_batchSize(DefaultBatchSize),
+    m_maxPendingBatches(2 * QThread::idealThreadCount()),
+    m_mapType(QVariantReader::VariantMap),
+    m_device(nullptr),
+    m_data(data),
+    m_position(0),
+    m_consumed(0),
+    m_inputEnd(data.isEmpty())
+{
+
+}
+
+QJsonVariantLinesReader::~QJsonVariantLinesReader()
+{
+    // batches in flight still point into m_data
+    while (!m_pending.isEmpty())
+        m_pending.dequeue()->done.acquire();
+}
+
+bool QJsonVariantLinesReader::atEnd() const
+{
+    return hasError() || (m_inputEnd && m_pending.isEmpty());
+}
+
+QVariantList QJsonVariantLinesReader::readBatch()
+{
+    if (hasError())
+        return QVariantList();
+
+    schedule();
+    if (m_pending.isEmpty())
+        return QVariantList();
+
+    QSharedPointer<Batch> batch = m_pending.dequeue();
+    batch->done.acquire();
+
+    if (batch->error != QJsonParseError::NoError) {
+        m_lastError = batch->error;
+        m_errorOffset = batch->errorOffset;
+        return batch->values;
+    }
+    m_consumed = batch->offset + batch->data.size();
+
+    // keep the pool busy while the caller handles this batch
+    schedule();
+    return batch->values;
+}
+
+QVariantList QJsonVariantLinesReader::readAll()
+{
+    QVariantList values;
+    while (!atEnd())
+        values.append(readBatch());
+    return values;
+}
+
+QJsonParseError QJsonVariantLinesReader::error() const
+{
+    QJsonParseError error;
+    error.error = lastError();
+    error.offset = hasError() ? m_errorOffset : currentOffset();
+    return error;
+}
+
+QByteArray QJsonVariantLinesReader::nextSlice()
+{
+    if (!m_device) {
+        // cut the in-memory input after the first line feed past batchSize
+        const char *data = m_data.constData();
+        const qint64 size = m_data.size();
+        const qint64 start = m_position;
+        qint64 stop = qMin(start + m_batchSize, size);
+        if (stop < size) {
+            const char *lineFeed = static_cast<const char *>(::memchr(data + stop, '\n', size - stop));
+            stop = lineFeed ? lineFeed - data + 1 : size;
+        }
+        m_position = stop;
+        m_inputEnd = stop >= size;
+        return QByteArray::fromRawData(data + start, stop - start);
+    }
+
+    // read until the batch holds at least one complete line; the partial
+    // line after the last line feed is carried over to the next batch
+    QByteArray chunk;
+    chunk.swap(m_carry);
+    while (true) {
+        const qsizetype kept = chunk.size();
+        chunk.resize(kept + m_batchSize);
+        const qint64 count = m_device->read(chunk.data() + kept, m_batchSize);
+        chunk.resize(kept + qMax<qint64>(count, 0));
+        if (count <= 0) {
+            m_inputEnd = true;
+            break;
+        }
+        const qsizetype lineFeed = QByteArrayView(chunk).sliced(kept).lastIndexOf('\n');
+        if (lineFeed >= 0) {
+            m_carry = chunk.sliced(kept + lineFeed + 1);
+            chunk.truncate(kept + lineFeed + 1);
+            break;
+        }
+    }
+    m_position += chunk.size();
+    return chunk;
+}
+
+void QJsonVariantLinesReader::schedule()
+{
+    QThreadPool *pool = m_threadPool ? m_threadPool : QThreadPool::globalInstance();
+
+    while (m_pending.size() < m_maxPendingBatches && !m_inputEnd) {
+        const qint64 offset = m_position;
+        QByteArray data = nextSlice();
+        if (data.isEmpty())
+            continue;
+
+        QSharedPointer<Batch> batch = QSharedPointer<Batch>::create();
+        batch->data = data;
+        batch->offset = offset;
+        batch->options = m_options;
+        batch->mapType = m_mapType;
+
+        pool->start([batch]() {
+            batch->parse();
+            batch->done.release();
+        });
+        m_pending.enqueue(batch);
+    }
+}
+
+QVariantList QJsonVariantLinesReader::fromJsonLines(const QByteArray& json, QJsonParseError* error)
+{
+    QJsonVariantLinesReader reader(json);
+    QVariantList values = reader.readAll();
+    if(error)
+        *error = reader.error();
+    return values;
+}
+
+QVariantList QJsonVariantLinesReader::fromJsonLines(QIODevice* device, QJsonParseError* error)
+{
+    QJsonVariantLinesReader reader(device);
+    QVariantList values = reader.readAll();
+    if(error)
+        *error = reader.error();
+    return values;
+}
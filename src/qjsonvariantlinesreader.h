@@ -0,0 +1,80 @@
+#ifndef QJSONVARIANTLINESREADER_H
+#define QJSONVARIANTLINESREADER_H
+
+#include <QVariant>
+#include <QByteArray>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QJsonParseError>
+
+#include "qvariantreader.h"
+
+class QIODevice;
+class QThreadPool;
+class QJsonVariantLinesReader
+{
+public:
+    enum { DefaultBatchSize = 1024 * 1024 };
+
+    explicit QJsonVariantLinesReader(QIODevice *device);
+    explicit QJsonVariantLinesReader(const QByteArray &data);
+    ~QJsonVariantLinesReader();
+    Q_DISABLE_COPY(QJsonVariantLinesReader)
+
+    QThreadPool *threadPool() const { return m_threadPool; }
+    void setThreadPool(QThreadPool *pool) { m_threadPool = pool; }
+
+    qint64 batchSize() const { return m_batchSize; }
+    void setBatchSize(qint64 size) { m_batchSize = qMax<qint64>(size, 1); }
+
+    int maxPendingBatches() const { return m_maxPendingBatches; }
+    void setMaxPendingBatches(int count) { m_maxPendingBatches = qMax(count, 1); }
+
+    QVariantReader::ReadOptions readOptions() const { return m_options; }
+    void setReadOptions(QVariantReader::ReadOptions options) { m_options = options; }
+
+    QVariantReader::MapType mapType() const { return m_mapType; }
+    void setMapType(QVariantReader::MapType type) { m_mapType = type; }
+
+    bool atEnd() const;
+    QVariantList readBatch();
+    QVariantList readAll();
+
+    qint64 currentOffset() const { return m_consumed; }
+
+    bool hasError() const { return lastError() != QJsonParseError::NoError; }
+    QJsonParseError::ParseError lastError() const { return m_lastError; }
+    QJsonParseError error() const;
+
+    static QVariantList fromJsonLines(const QByteArray& json, QJsonParseError* error = nullptr);
+    static QVariantList fromJsonLines(QIODevice* device, QJsonParseError* error = nullptr);
+
+private:
+    struct Batch;
+
+    QByteArray nextSlice();
+    void schedule();
+
+    QJsonParseError::ParseError m_lastError;
+    qint64 m_errorOffset;
+
+    QThreadPool *m_threadPool;
+    qint64 m_batchSize;
+    int m_maxPendingBatches;
+    QVariantReader::ReadOptions m_options;
+    QVariantReader::MapType m_mapType;
+
+    // The input is cut into batches that end on a line feed; each batch is
+    // parsed by its own QJsonVariantReader on the pool and handed back in
+    // input order. At most m_maxPendingBatches are in flight at once.
+    QIODevice *m_device;
+    QByteArray m_data;
+    QByteArray m_carry;
+    qint64 m_position;
+    qint64 m_consumed;
+    bool m_inputEnd;
+
+    QQueue<QSharedPointer<Batch>> m_pending;
+};
+
+#endif // QJSONVARIANTLINESREADER_H
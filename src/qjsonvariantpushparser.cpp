@@ -0,0 +1,357 @@
+#include "qjsonvariantpushparser.h"
+#include <cstring>
+
+#include "qutf8.h"
+#include "qjsonscanner.h"
+#include "qjsonnumber.h"
+
+static inline bool isWhitespace(char c)
+{
+    return c == 0x20 || c == 0x09 || c == 0x0a || c == 0x0d;
+}
+
+static inline bool isDelimiter(char c)
+{
+    switch (c) {
+    case 0x5b: // [
+    case 0x7b: // {
+    case 0x5d: // ]
+    case 0x7d: // }
+    case 0x3a: // :
+    case 0x2c: // ,
+    case 0x22: // "
+        return true;
+    default:
+        return isWhitespace(c);
+    }
+}
+
+QJsonVariantPushParser::QJsonVariantPushParser()
+{
+    reset();
+}
+
+QJsonVariantPushParser::~QJsonVariantPushParser()
+{
+
+}
+
+void QJsonVariantPushParser::reset()
+{
+    m_lastError = QJsonParseError::NoError;
+    m_errorOffset = 0;
+    m_consumed = 0;
+    m_chunk = nullptr;
+    m_byteOrderMark = 0;
+    clearState();
+    m_values.clear();
+}
+
+void QJsonVariantPushParser::clearState()
+{
+    m_stack.clear();
+    m_state = ValueState;
+    m_token = NoToken;
+    m_escape = false;
+    m_isUtf8 = true;
+    m_tokenOffset = 0;
+    m_tokenBuffer.clear();
+}
+
+void QJsonVariantPushParser::feed(const QByteArray &data)
+{
+    if (hasError() || data.isEmpty())
+        return;
+
+    m_chunk = data.constData();
+    const char *ptr = m_chunk;
+    const char *const end = ptr + data.size();
+    ptr = skipByteOrderMark(ptr, end);
+
+    while (ptr < end && !hasError()) {
+        switch (m_token) {
+        case StringToken:
+            ptr = scanString(ptr, end);
+            break;
+        case ScalarToken:
+            ptr = scanScalar(ptr, end);
+            break;
+        default:
+            ptr = QJsonScanner::skipWhitespace(ptr, end);
+            if (ptr < end)
+                ptr = parseStructural(ptr);
+            break;
+        }
+    }
+
+    m_consumed += data.size();
+    m_chunk = nullptr;
+}
+
+bool QJsonVariantPushParser::finish()
+{
+    if (!hasError()) {
+        if (m_byteOrderMark > 0) {
+            // the input stopped inside a byte order mark
+            setError(QJsonParseError::IllegalValue, 0);
+        } else if (m_token == StringToken) {
+            setError(QJsonParseError::UnterminatedString, m_consumed);
+        } else if (m_token == ScalarToken && m_stack.isEmpty()) {
+            // a top-level scalar ends with the input
+            completeScalar(m_tokenBuffer.constBegin(), m_tokenBuffer.constEnd());
+        } else if (!m_stack.isEmpty()) {
+            setError(m_stack.last().isObject ? QJsonParseError::UnterminatedObject
+                                             : QJsonParseError::UnterminatedArray, m_consumed);
+        }
+    }
+
+    const bool ok = !hasError();
+    m_byteOrderMark = -1;
+    clearState();
+    return ok;
+}
+
+QVariant QJsonVariantPushParser::takeValue()
+{
+    if (m_values.isEmpty())
+        return QVariant();
+    return m_values.dequeue();
+}
+
+QVariantList QJsonVariantPushParser::takeValues()
+{
+    QVariantList values;
+    values.reserve(m_values.size());
+    while (!m_values.isEmpty())
+        values.append(m_values.dequeue());
+    return values;
+}
+
+QJsonParseError QJsonVariantPushParser::error() const
+{
+    QJsonParseError error;
+    error.error = lastError();
+    error.offset = hasError() ? m_errorOffset : currentOffset();
+    return error;
+}
+
+void QJsonVariantPushParser::setError(QJsonParseError::ParseError error, qint64 offset)
+{
+    m_lastError = error;
+    m_errorOffset = offset;
+}
+
+const char *QJsonVariantPushParser::skipByteOrderMark(const char *ptr, const char *end)
+{
+    // the UTF-8 byte order mark may itself arrive split across feeds
+    static const uchar utf8bom[3] = { 0xef, 0xbb, 0xbf };
+    while (m_byteOrderMark >= 0 && ptr < end) {
+        if (uchar(*ptr) != utf8bom[m_byteOrderMark]) {
+            if (m_byteOrderMark > 0)
+                setError(QJsonParseError::IllegalValue, 0);
+            m_byteOrderMark = -1;
+            break;
+        }
+        ++ptr;
+        if (++m_byteOrderMark == 3)
+            m_byteOrderMark = -1;
+    }
+    return ptr;
+}
+
+const char *QJsonVariantPushParser::parseStructural(const char *ptr)
+{
+    const char c = *ptr;
+    switch (m_state) {
+    case NameSeparatorState:
+        if (c != ':') {
+            setError(QJsonParseError::MissingNameSeparator, offsetOf(ptr));
+            return ptr;
+        }
+        m_state = ValueState;
+        return ptr + 1;
+
+    case ValueSeparatorState: {
+        const bool isObject = m_stack.last().isObject;
+        if (c == ',') {
+            m_state = isObject ? KeyState : ValueState;
+            return ptr + 1;
+        }
+        if (c != (isObject ? '}' : ']')) {
+            setError(QJsonParseError::MissingValueSeparator, offsetOf(ptr));
+            return ptr;
+        }
+        break;
+    }
+
+    case FirstKeyState:
+        if (c == '}')
+            break;
+        Q_FALLTHROUGH();
+    case KeyState:
+        if (c != '"') {
+            setError(QJsonParseError::MissingObject, offsetOf(ptr));
+            return ptr;
+        }
+        m_token = StringToken;
+        m_isUtf8 = true;
+        m_tokenOffset = offsetOf(ptr);
+        return ptr + 1;
+
+    case FirstValueState:
+        if (c == ']')
+            break;
+        Q_FALLTHROUGH();
+    case ValueState:
+    default:
+        switch (c) {
+        case '"':
+            m_token = StringToken;
+            m_isUtf8 = true;
+            m_tokenOffset = offsetOf(ptr);
+            return ptr + 1;
+        case '[':
+        case '{':
+            m_stack.append(Frame{c == '{', QVariantList(), QVariantMap(), QString()});
+            m_state = c == '{' ? FirstKeyState : FirstValueState;
+            return ptr + 1;
+        case ']':
+        case '}':
+            setError(QJsonParseError::MissingObject, offsetOf(ptr));
+            return ptr;
+        case ',':
+        case ':':
+            setError(QJsonParseError::IllegalValue, offsetOf(ptr));
+            return ptr;
+        default:
+            // numbers and literals are read up to the next delimiter
+            m_token = ScalarToken;
+            m_tokenOffset = offsetOf(ptr);
+            return ptr;
+        }
+    }
+
+    // the closing bracket of the innermost container
+    Frame frame = m_stack.takeLast();
+    completeValue(frame.isObject ? QVariant(frame.map) : QVariant(frame.list));
+    return ptr + 1;
+}
+
+const char *QJsonVariantPushParser::scanString(const char *ptr, const char *end)
+{
+    const char *start = ptr;
+    while (ptr < end) {
+        if (m_escape) {
+            // the byte after a backslash, possibly the first of this feed
+            m_escape = false;
+            ++ptr;
+            continue;
+        }
+        ptr = QJsonScanner::findStringSpecial(ptr, end);
+        if (ptr >= end)
+            break;
+        if (*ptr == '"') {
+            // strings that fit in one feed are decoded in place
+            if (m_tokenBuffer.isEmpty()) {
+                completeString(start, ptr);
+            } else {
+                m_tokenBuffer.append(start, ptr - start);
+                completeString(m_tokenBuffer.constBegin(), m_tokenBuffer.constEnd());
+                m_tokenBuffer.resize(0);
+            }
+            return ptr + 1;
+        }
+        if (*ptr == '\\') {
+            m_isUtf8 = false;
+            m_escape = true;
+        }
+        ++ptr;
+    }
+    m_tokenBuffer.append(start, ptr - start);
+    return ptr;
+}
+
+const char *QJsonVariantPushParser::scanScalar(const char *ptr, const char *end)
+{
+    const char *start = ptr;
+    while (ptr < end && !isDelimiter(*ptr))
+        ++ptr;
+    if (ptr == end) {
+        m_tokenBuffer.append(start, ptr - start);
+        return ptr;
+    }
+
+    // the delimiter belongs to whatever follows the scalar
+    if (m_tokenBuffer.isEmpty()) {
+        completeScalar(start, ptr);
+    } else {
+        m_tokenBuffer.append(start, ptr - start);
+        completeScalar(m_tokenBuffer.constBegin(), m_tokenBuffer.constEnd());
+        m_tokenBuffer.resize(0);
+    }
+    return ptr;
+}
+
+void QJsonVariantPushParser::completeString(const char *start, const char *stop)
+{
+    m_token = NoToken;
+    QString string = m_isUtf8 ? QString::fromUtf8(start, stop - start)
+                              : QUtf8::unescapedString(start, stop);
+    if (m_state == FirstKeyState || m_state == KeyState) {
+        m_stack.last().key = std::move(string);
+        m_state = NameSeparatorState;
+        return;
+    }
+    completeValue(QVariant(string));
+}
+
+void QJsonVariantPushParser::completeScalar(const char *start, const char *stop)
+{
+    m_token = NoToken;
+    const qsizetype length = stop - start;
+    if (length == 4 && std::memcmp(start, "null", 4) == 0) {
+        completeValue(QVariant::fromValue(nullptr));
+        return;
+    }
+    if (length == 4 && std::memcmp(start, "true", 4) == 0) {
+        completeValue(QVariant(true));
+        return;
+    }
+    if (length == 5 && std::memcmp(start, "false", 5) == 0) {
+        completeValue(QVariant(false));
+        return;
+    }
+
+    qint64 n;
+    double d;
+    switch (QJsonNumber::parse(start, stop, &n, &d)) {
+    case QJsonNumber::Integer:
+        completeValue(QVariant(qlonglong(n)));
+        return;
+    case QJsonNumber::Double:
+        completeValue(QVariant(d));
+        return;
+    case QJsonNumber::Invalid:
+    default:
+        setError(*start == '-' || QUtf8::isAsciiDigit(*start) ? QJsonParseError::IllegalNumber
+                                                              : QJsonParseError::IllegalValue,
+                 m_tokenOffset);
+        return;
+    }
+}
+
+void QJsonVariantPushParser::completeValue(QVariant &&value)
+{
+    if (m_stack.isEmpty()) {
+        m_values.enqueue(std::move(value));
+        m_state = ValueState;
+        return;
+    }
+
+    Frame &frame = m_stack.last();
+    if (frame.isObject)
+        frame.map.insert(frame.key, std::move(value));
+    else
+        frame.list.append(std::move(value));
+    m_state = ValueSeparatorState;
+}
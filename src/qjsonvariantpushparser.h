@@ -0,0 +1,90 @@
+#ifndef QJSONVARIANTPUSHPARSER_H
+#define QJSONVARIANTPUSHPARSER_H
+
+#include <QVariant>
+#include <QByteArray>
+#include <QList>
+#include <QQueue>
+#include <QJsonParseError>
+
+class QJsonVariantPushParser
+{
+public:
+    QJsonVariantPushParser();
+    ~QJsonVariantPushParser();
+    Q_DISABLE_COPY(QJsonVariantPushParser)
+
+    void feed(const QByteArray &data);
+    bool finish();
+    void reset();
+
+    bool hasValue() const { return !m_values.isEmpty(); }
+    int valueCount() const { return m_values.size(); }
+    QVariant takeValue();
+    QVariantList takeValues();
+
+    qint64 currentOffset() const { return m_consumed; }
+
+    bool hasError() const { return lastError() != QJsonParseError::NoError; }
+    QJsonParseError::ParseError lastError() const { return m_lastError; }
+    QJsonParseError error() const;
+
+private:
+    // What the grammar expects next.
+    enum State : quint8 {
+        ValueState,             // top level, after ':', after ',' in an array
+        FirstValueState,        // after '[': a value or ']'
+        FirstKeyState,          // after '{': a key or '}'
+        KeyState,               // after ',' in an object
+        NameSeparatorState,     // after a key
+        ValueSeparatorState     // after a member: ',' or the closing bracket
+    };
+
+    // The token being read, which may span any number of feeds.
+    enum Token : quint8 {
+        NoToken,
+        StringToken,
+        ScalarToken
+    };
+
+    struct Frame
+    {
+        bool isObject;
+        QVariantList list;
+        QVariantMap map;
+        QString key;
+    };
+
+    qint64 offsetOf(const char *ptr) const { return m_consumed + (ptr - m_chunk); }
+    void setError(QJsonParseError::ParseError error, qint64 offset);
+
+    const char *skipByteOrderMark(const char *ptr, const char *end);
+    const char *parseStructural(const char *ptr);
+    const char *scanString(const char *ptr, const char *end);
+    const char *scanScalar(const char *ptr, const char *end);
+    void completeString(const char *start, const char *stop);
+    void completeScalar(const char *start, const char *stop);
+    void completeValue(QVariant &&value);
+    void clearState();
+
+    QJsonParseError::ParseError m_lastError;
+    qint64 m_errorOffset;
+
+    // Resumable grammar state: the open containers with what they hold so
+    // far, and the bytes of a token split across feeds. Values are built as
+    // the bytes arrive; nothing is parsed twice or buffered whole.
+    qint64 m_consumed;
+    const char *m_chunk;
+    QList<Frame> m_stack;
+    State m_state;
+    Token m_token;
+    bool m_escape;
+    bool m_isUtf8;
+    int m_byteOrderMark;
+    qint64 m_tokenOffset;
+    QByteArray m_tokenBuffer;
+
+    QQueue<QVariant> m_values;
+};
+
+#endif // QJSONVARIANTPUSHPARSER_H
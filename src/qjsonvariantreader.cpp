@@ -2,8 +2,18 @@
 #include <QBuffer>
 #include <QVariant>
 #include <QJsonValue>
+#include <QAnyStringView>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QAtomicInt>
+#include <cstring>
 
 #include "qutf8.h"
+#include "qjsonscanner.h"
+#include "qjsonnumber.h"
+#include "qjsonstructuralindex.h"
+#include "qvarianthandler.h"
 
 enum {
     Space = 0x20,
@@ -19,14 +29,102 @@ enum {
     Quote = 0x22
 };
 
-QJsonVariantReader::QJsonVariantReader(QIODevice *device):
-    QJsonVariantReader(device->readAll())
+namespace {
+
+// First phase of fromJsonParallel(): walks the top-level array starting
+// at begin ('[') and records a depth-1 comma roughly every sliceSize
+// bytes. Strings are skipped whole, so brackets and commas inside them are
+// ignored. Returns the closing bracket, or nullptr when the array does not
+// close.
+const char *splitArray(const char *begin, const char *end, qsizetype sliceSize, QList<const char *> *cuts)
 {
+    const char *ptr = begin + 1;
+    const char *nextCut = ptr + sliceSize;
+    int depth = 1;
+    while (ptr < end) {
+        // commas only matter between the elements of the top-level array
+        ptr = depth == 1 ? QJsonScanner::findStructural(ptr, end)
+                         : QJsonScanner::findBracketOrQuote(ptr, end);
+        if (ptr >= end)
+            break;
+        switch (*ptr) {
+        case Quote:
+            ++ptr;
+            while (true) {
+                ptr = QJsonScanner::findStringSpecial(ptr, end);
+                if (ptr >= end)
+                    return nullptr;
+                if (*ptr == Quote)
+                    break;
+                if (*ptr == '\\')
+                    ++ptr;
+                ++ptr;
+            }
+            break;
+        case BeginArray:
+        case BeginObject:
+            ++depth;
+            break;
+        case EndArray:
+        case EndObject:
+            if (--depth == 0)
+                return ptr;
+            break;
+        case ValueSeparator:
+            if (ptr >= nextCut) {
+                cuts->append(ptr);
+                nextCut = ptr + sliceSize;
+            }
+            break;
+        }
+        ++ptr;
+    }
+    return nullptr;
+}
 
+// Parses the elements of one slice of the top-level array.
+bool parseSlice(const char *begin, const char *end, QVariantList *values)
+{
+    QJsonVariantReader reader(QByteArray::fromRawData(begin, end - begin));
+    while (!reader.hasError() && !reader.atEnd())
+        values->append(reader.read());
+    return !reader.hasError();
+}
+
+} // namespace
+
+QJsonVariantReader::QJsonVariantReader(QIODevice *device, qint64 chunkSize):
+    m_lastError(QJsonParseError::NoError),
+    m_device(device),
+    m_chunkSize(qMax<qint64>(chunkSize, 16)),
+    m_offset(0),
+    m_size(device->isSequential() ? device->bytesAvailable() : device->size() - device->pos()),
+    json(nullptr),
+    ptr(nullptr),
+    end(nullptr)
+{
+    // a file is parsed straight from its mapping, other devices through
+    // the sliding window
+    m_buffer = mapFile(device);
+    if (!m_buffer.isNull()) {
+        m_device = nullptr;
+        m_size = m_buffer.size();
+        json = ptr = m_buffer.constData();
+        end = json + m_buffer.size();
+    } else {
+        m_buffer.reserve(m_chunkSize);
+        fetchMore(ptr);
+    }
+    skipByteOrderMark();
+    skipWhitespace();
 }
 
 QJsonVariantReader::QJsonVariantReader(const QByteArray &data):
     m_lastError(QJsonParseError::NoError),
+    m_device(nullptr),
+    m_chunkSize(0),
+    m_offset(0),
+    m_size(data.size()),
     m_buffer(data),
     json(m_buffer.constData()),
     ptr(m_buffer.constData()),
@@ -47,7 +145,7 @@ bool QJsonVariantReader::hasNext() const
 }
 bool QJsonVariantReader::next()
 {
-    while (ptr < end && skipWhitespace()) {
+    while (skipWhitespace()) {
         if (*ptr != NameSeparator &&
             *ptr != ValueSeparator)
             break;
@@ -62,7 +160,7 @@ bool QJsonVariantReader::atEnd()
 
 bool QJsonVariantReader::enterContainer()
 {
-    if(*ptr!=BeginArray && *ptr!=BeginObject) {
+    if(ptr>=end || (*ptr!=BeginArray && *ptr!=BeginObject)) {
         m_lastError = QJsonParseError::IllegalValue;
         return false;
     }
@@ -71,7 +169,7 @@ bool QJsonVariantReader::enterContainer()
 }
 bool QJsonVariantReader::leaveContainer()
 {
-    if(*ptr!=EndArray && *ptr!=EndObject) {
+    if(ptr>=end || (*ptr!=EndArray && *ptr!=EndObject)) {
         m_lastError = QJsonParseError::IllegalValue;
         return false;
     }
@@ -79,8 +177,93 @@ bool QJsonVariantReader::leaveContainer()
     return next();
 }
 
+bool QJsonVariantReader::skipValue()
+{
+    if (ptr >= end) {
+        m_lastError = QJsonParseError::IllegalValue;
+        return false;
+    }
+
+    switch (*ptr) {
+    case Quote:
+        if (!skipString())
+            return false;
+        return next();
+    case BeginArray:
+    case BeginObject: {
+        // only brackets and strings matter, nothing is decoded
+        const bool isArray = *ptr == BeginArray;
+        int depth = 0;
+        while (hasMore(ptr)) {
+            ptr = QJsonScanner::findBracketOrQuote(ptr, end);
+            if (ptr >= end)
+                continue;
+            switch (*ptr) {
+            case Quote:
+                if (!skipString())
+                    return false;
+                continue;
+            case BeginArray:
+            case BeginObject:
+                ++depth;
+                break;
+            default:
+                if (--depth == 0) {
+                    ++ptr;
+                    return next();
+                }
+                break;
+            }
+            ++ptr;
+        }
+        m_lastError = isArray ? QJsonParseError::UnterminatedArray : QJsonParseError::UnterminatedObject;
+        return false;
+    }
+    default:
+        // literals and numbers do not allocate
+        readValue();
+        return !hasError();
+    }
+}
+
+bool QJsonVariantReader::matchKey(QStringView key)
+{
+    if (ptr >= end || *ptr != Quote)
+        return QVariantReader::matchKey(key);
+
+    const char *start;
+    bool isUtf8;
+    if (!scanString(start, isUtf8))
+        return false;
+
+    // compare the UTF-8 bytes in place unless there are escapes to decode
+    const qsizetype len = ptr - start - 1; // exclude closing quote
+    const bool match = isUtf8 ? QAnyStringView::equal(QUtf8StringView(start, len), key)
+                              : QUtf8::unescapedString(start, start + len) == key;
+    next();
+    return match;
+}
+
+bool QJsonVariantReader::parseKey(QVariantHandler *handler)
+{
+    if (ptr >= end || *ptr != Quote)
+        return QVariantReader::parseKey(handler);
+    return parseString(handler, true);
+}
+
+bool QJsonVariantReader::parseValue(QVariantHandler *handler)
+{
+    if (ptr >= end || *ptr != Quote)
+        return QVariantReader::parseValue(handler);
+    return parseString(handler, false);
+}
+
 QVariantReader::Type QJsonVariantReader::type() const
 {
+    // the buffer may be a mapping or raw data, never look past its end
+    if (ptr >= end)
+        return QJsonVariantReader::Invalid;
+
     switch (*ptr) {
     case BeginArray:
         return QJsonVariantReader::List;
@@ -104,6 +287,13 @@ QVariantReader::Type QJsonVariantReader::type() const
     }
 }
 
+QString QJsonVariantReader::readKey()
+{
+    if (ptr < end && *ptr == Quote)
+        return parseString(true);
+    return QVariantReader::readKey();
+}
+
 QVariant QJsonVariantReader::readValue()
 {
     if (ptr >= end) {
@@ -114,7 +304,7 @@ QVariant QJsonVariantReader::readValue()
     switch (*ptr) {
     case 'n':
         ++ptr;
-        if (end - ptr < 3) {
+        if (!ensureAvailable(3)) {
             m_lastError = QJsonParseError::IllegalValue;
             return QVariant();
         }
@@ -128,7 +318,7 @@ QVariant QJsonVariantReader::readValue()
         return QVariant();
     case 't':
         ++ptr;
-        if (end - ptr < 3) {
+        if (!ensureAvailable(3)) {
             m_lastError = QJsonParseError::IllegalValue;
             return QVariant();
         }
@@ -142,7 +332,7 @@ QVariant QJsonVariantReader::readValue()
         return QVariant();
     case 'f':
         ++ptr;
-        if (end - ptr < 4) {
+        if (!ensureAvailable(4)) {
             m_lastError = QJsonParseError::IllegalValue;
             return QVariant();
         }
@@ -171,11 +361,51 @@ QVariant QJsonVariantReader::readValue()
     }
 }
 
+bool QJsonVariantReader::fetchMore(const char *&keep)
+{
+    if (!m_device)
+        return false;
+
+    // Slide the window: drop what was consumed before keep, move the
+    // pending bytes to the front and append the next chunk after them.
+    const qsizetype discarded = keep - json;
+    const qsizetype kept = end - keep;
+    const qsizetype position = ptr - keep;
+    if (discarded > 0) {
+        ::memmove(m_buffer.data(), keep, kept);
+        m_offset += discarded;
+    }
+
+    m_buffer.resize(kept + m_chunkSize);
+    const qint64 count = m_device->read(m_buffer.data() + kept, m_chunkSize);
+    m_buffer.resize(kept + qMax<qint64>(count, 0));
+
+    json = m_buffer.constData();
+    keep = json;
+    ptr = json + position;
+    end = json + m_buffer.size();
+    return count > 0;
+}
+
+bool QJsonVariantReader::hasMore(const char *&keep)
+{
+    return ptr < end || fetchMore(keep);
+}
+
+bool QJsonVariantReader::ensureAvailable(qint64 count)
+{
+    while (end - ptr < count) {
+        if (!fetchMore(ptr))
+            return false;
+    }
+    return true;
+}
+
 void QJsonVariantReader::skipByteOrderMark()
 {
     // eat UTF-8 byte order mark
     uchar utf8bom[3] = { 0xef, 0xbb, 0xbf };
-    if (end - ptr > 3 &&
+    if (ensureAvailable(4) &&
         (uchar)ptr[0] == utf8bom[0] &&
         (uchar)ptr[1] == utf8bom[1] &&
         (uchar)ptr[2] == utf8bom[2])
@@ -184,113 +414,220 @@ void QJsonVariantReader::skipByteOrderMark()
 
 bool QJsonVariantReader::skipWhitespace()
 {
-    while (ptr < end) {
-        if (*ptr > Space)
-            break;
-        if (*ptr != Space &&
-            *ptr != Tab &&
-            *ptr != LineFeed &&
-            *ptr != Return)
+    while (hasMore(ptr)) {
+        ptr = QJsonScanner::skipWhitespace(ptr, end);
+        if (ptr < end)
             break;
-        ++ptr;
     }
     return (ptr < end);
 }
 
-QString QJsonVariantReader::parseString()
+bool QJsonVariantReader::scanString(const char *&start, bool &isUtf8)
 {
-    if(*ptr!=Quote) {
-        m_lastError = QJsonParseError::MissingObject;
-        return QString();
-    }
-    ++ptr;
+    ++ptr; // skip '"'
 
-    bool isUtf8 = true;
-    const char* start = ptr;
-    while (ptr < end && *ptr != '"') {
+    isUtf8 = true;
+    start = ptr;
+    while (hasMore(start)) {
+        // jump to the next quote, backslash or control character
+        ptr = QJsonScanner::findStringSpecial(ptr, end);
+        if (ptr >= end)
+            continue;
+        if (*ptr == '"')
+            break;
         if (*ptr == '\\') {
             ++ptr;
             isUtf8 = false;
+            if (!hasMore(start))
+                break;
         }
         ++ptr;
     }
-    if (ptr < end && *ptr == '"')
+    if (ptr < end && *ptr == '"') {
+        ++ptr;
+        return true;
+    }
+    m_lastError = QJsonParseError::UnterminatedString;
+    return false;
+}
+
+bool QJsonVariantReader::skipString()
+{
+    ++ptr; // skip '"'
+
+    // unlike scanString(), nothing is kept, so the window never grows
+    while (hasMore(ptr)) {
+        ptr = QJsonScanner::findStringSpecial(ptr, end);
+        if (ptr >= end)
+            continue;
+        if (*ptr == '"') {
+            ++ptr;
+            return true;
+        }
+        if (*ptr == '\\') {
+            ++ptr;
+            if (!hasMore(ptr))
+                break;
+        }
         ++ptr;
-    else {
-        m_lastError = QJsonParseError::UnterminatedString;
+    }
+    m_lastError = QJsonParseError::UnterminatedString;
+    return false;
+}
+
+QString QJsonVariantReader::parseString(bool isKey)
+{
+    if(*ptr!=Quote) {
+        m_lastError = QJsonParseError::MissingObject;
         return QString();
     }
 
+    const char *start;
+    bool isUtf8;
+    if (!scanString(start, isUtf8))
+        return QString();
+
+    // decode before next(), which may slide the window away from start
     int len = ptr - start;
-    next();
+    const bool intern = isInternable(isKey, len-1);
+    QString string;
+    if (intern) {
+        string = internedString(start, len-1);
+        if (!string.isNull()) {
+            next();
+            return string;
+        }
+    }
     if(isUtf8) {
-        return QString::fromUtf8(start, len-1); // exclude surrounding quotes
+        string = QString::fromUtf8(start, len-1); // exclude surrounding quotes
+    } else {
+        string = QUtf8::unescapedString(start, start + len - 1); // exclude surrounding quotes
     }
-    QByteArray sub(start, len-1); // exclude surrounding quotes
-    return QUtf8::unescapedString(sub);
+    if (intern)
+        internString(start, len-1, string);
+    next();
+    return string;
 }
 
-QVariant QJsonVariantReader::parseNumber()
+bool QJsonVariantReader::parseString(QVariantHandler *handler, bool isKey)
 {
-    const char *start = ptr;
-    bool isInt = true;
+    const char *start;
+    bool isUtf8;
+    if (!scanString(start, isUtf8))
+        return false;
+
+    // hand the view over before next(), which may slide the window away
+    // from start; only escaped strings are decoded, into a reused buffer
+    const char *stop = ptr - 1; // exclude closing quote
+    QAnyStringView string;
+    if (isUtf8) {
+        string = QUtf8StringView(start, stop - start);
+    } else {
+        QUtf8::unescapedString(start, stop, m_stringBuffer);
+        string = m_stringBuffer;
+    }
+    const bool ok = isKey ? handler->key(string) : handler->string(string);
+    next();
+    return ok;
+}
+
+bool QJsonVariantReader::scanNumber(const char *&start)
+{
+    start = ptr;
 
     // minus
-    if (ptr < end && *ptr == '-')
+    if (hasMore(start) && *ptr == '-')
         ++ptr;
 
-    // int = zero / ( digit1-9 *DIGIT )
-    if (ptr < end && *ptr == '0') {
+    // int = zero / ( digit1-9 *DIGIT ), the whole digit run is taken so
+    // that QJsonNumber::parse() rejects a leading zero as one token
+    while (hasMore(start) && QUtf8::isAsciiDigit(*ptr))
         ++ptr;
-    } else {
-        while (ptr < end && QUtf8::isAsciiDigit(*ptr))
-            ++ptr;
-    }
 
     // frac = decimal-point 1*DIGIT
-    if (ptr < end && *ptr == '.') {
+    if (hasMore(start) && *ptr == '.') {
         ++ptr;
-        while (ptr < end && QUtf8::isAsciiDigit(*ptr)) {
-            isInt = isInt && *ptr == '0';
+        while (hasMore(start) && QUtf8::isAsciiDigit(*ptr))
             ++ptr;
-        }
     }
 
     // exp = e [ minus / plus ] 1*DIGIT
-    if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
-        isInt = false;
+    if (hasMore(start) && (*ptr == 'e' || *ptr == 'E')) {
         ++ptr;
-        if (ptr < end && (*ptr == '-' || *ptr == '+'))
+        if (hasMore(start) && (*ptr == '-' || *ptr == '+'))
             ++ptr;
-        while (ptr < end && QUtf8::isAsciiDigit(*ptr))
+        while (hasMore(start) && QUtf8::isAsciiDigit(*ptr))
             ++ptr;
     }
 
     if (json >= end) {
         m_lastError = QJsonParseError::TerminationByNumber;
+        return false;
+    }
+    return true;
+}
+
+QVariant QJsonVariantReader::parseNumber()
+{
+    const char *start;
+    if (!scanNumber(start))
+        return QVariant();
+
+    // convert before next(), which may slide the window away from start
+    qint64 n;
+    double d;
+    QVariant result;
+    switch (QJsonNumber::parse(start, ptr, &n, &d)) {
+    case QJsonNumber::Integer:
+        result = QVariant(qlonglong(n));
+        break;
+    case QJsonNumber::Double:
+        result = QVariant(d);
+        break;
+    case QJsonNumber::Invalid:
+    default:
+        m_lastError = QJsonParseError::IllegalNumber;
         return QVariant();
     }
 
-    const QByteArray number = QByteArray::fromRawData(start, ptr - start);
     next();
+    return result;
+}
 
-    if (isInt) {
-        bool ok;
-        qlonglong n = number.toLongLong(&ok);
-        if (ok) {
-            return QVariant(n);
+bool QJsonVariantReader::validateValue()
+{
+    // read() without building anything: the same moves, so the same errors
+    // at the same offsets
+    switch (type()) {
+    case QJsonVariantReader::List:
+    case QJsonVariantReader::Map: {
+        const bool isMap = type() == QJsonVariantReader::Map;
+        enterContainer();
+        while (!hasError() && hasNext()) {
+            // like readMap(), the value is read even when the key failed
+            if (isMap) {
+                if (*ptr != Quote)
+                    validateValue();
+                else if (skipString())
+                    next();
+            }
+            validateValue();
         }
+        if (!hasError())
+            leaveContainer();
+        return !hasError();
     }
-
-    bool ok;
-    double d = number.toDouble(&ok);
-
-    if (!ok) {
-        m_lastError = QJsonParseError::IllegalNumber;
-        return QVariant();
+    default:
+        if (ptr < end && *ptr == Quote) {
+            if (!skipString())
+                return false;
+            next();
+            return true;
+        }
+        // literals and numbers do not allocate
+        readValue();
+        return !hasError();
     }
-
-    return QVariant(d);
 }
 
 QJsonParseError QJsonVariantReader::error() const
@@ -301,8 +638,26 @@ QJsonParseError QJsonVariantReader::error() const
     return error;
 }
 
-QVariant QJsonVariantReader::fromJson(const QByteArray& json, QJsonParseError* error)
+QVariant QJsonVariantReader::fromJson(const QByteArray& json, QJsonParseError* error, Engine engine)
 {
+    if (engine == StructuralIndexEngine) {
+        const char *begin = json.constBegin();
+        if (json.size() >= 4 && uchar(begin[0]) == 0xef && uchar(begin[1]) == 0xbb && uchar(begin[2]) == 0xbf)
+            begin += 3;
+
+        QJsonStructuralIndex index;
+        QVariant variant;
+        if (index.build(begin, json.constEnd()) && index.parse(&variant)) {
+            if (error) {
+                error->error = QJsonParseError::NoError;
+                error->offset = json.size();
+            }
+            return variant;
+        }
+        // the index engine only takes strict JSON: anything else, and the
+        // error report, is left to the streaming engine
+    }
+
     QJsonVariantReader reader(json);
     QVariant variant = reader.read();
     if(error)
@@ -318,3 +673,110 @@ QVariant QJsonVariantReader::fromJson(QIODevice* device, QJsonParseError* error)
         *error = reader.error();
     return variant;
 }
+
+QVariant QJsonVariantReader::fromJsonParallel(const QByteArray& json, QJsonParseError* error, QThreadPool* pool)
+{
+    const char *begin = json.constBegin();
+    const char *end = json.constEnd();
+    if (end - begin >= 3 && uchar(begin[0]) == 0xef && uchar(begin[1]) == 0xbb && uchar(begin[2]) == 0xbf)
+        begin += 3;
+    begin = QJsonScanner::skipWhitespace(begin, end);
+
+    if (!pool)
+        pool = QThreadPool::globalInstance();
+
+    // only a large top-level array is worth splitting, in slices sized for
+    // the pool that parses them
+    const int threads = pool->maxThreadCount();
+    const qsizetype sliceSize = qMax<qsizetype>((end - begin) / (4 * qMax(threads, 1)), MinimumSliceSize);
+    if (threads < 2 || end - begin < 2 * sliceSize || *begin != BeginArray)
+        return fromJson(json, error);
+
+    QList<const char *> cuts;
+    const char *closing = splitArray(begin, end, sliceSize, &cuts);
+    if (!closing || *closing != EndArray || cuts.isEmpty()) {
+        // let the sequential reader report the error, or parse the
+        // array when no slice boundary was found
+        return fromJson(json, error);
+    }
+
+    // slice i runs from after cut i-1 to cut i, each without its comma
+    const qsizetype count = cuts.size() + 1;
+    QList<QVariantList> slices(count);
+    QVariantList *results = slices.data();
+    QAtomicInt failed(0);
+    QSemaphore done;
+    QList<QRunnable *> runnables(count - 1);
+
+    for (qsizetype i = 0; i < count - 1; ++i) {
+        const char *sliceBegin = i == 0 ? begin + 1 : cuts.at(i - 1) + 1;
+        const char *sliceEnd = cuts.at(i);
+        runnables[i] = QRunnable::create([sliceBegin, sliceEnd, results, i, &failed, &done]() {
+            if (!parseSlice(sliceBegin, sliceEnd, results + i))
+                failed.storeRelaxed(1);
+            done.release();
+        });
+        runnables[i]->setAutoDelete(false);
+        pool->start(runnables[i]);
+    }
+    // the calling thread takes the last slice, then the ones the pool has
+    // not started, so this also makes progress on a busy pool
+    if (!parseSlice(cuts.last() + 1, closing, results + count - 1))
+        failed.storeRelaxed(1);
+    for (QRunnable *runnable : std::as_const(runnables)) {
+        if (pool->tryTake(runnable))
+            runnable->run();
+    }
+    done.acquire(count - 1);
+    qDeleteAll(runnables);
+
+    if (failed.loadRelaxed())
+        return fromJson(json, error);
+
+    qsizetype total = 0;
+    for (const QVariantList &slice : std::as_const(slices))
+        total += slice.size();
+    QVariantList list;
+    list.reserve(total);
+    for (QVariantList &slice : slices)
+        list.append(std::move(slice));
+
+    if (error) {
+        // where the sequential reader stops: past the closing bracket and
+        // the whitespace and separators after it
+        const char *ptr = closing + 1;
+        while (ptr < end && (*ptr == Space || *ptr == Tab || *ptr == LineFeed || *ptr == Return ||
+                             *ptr == NameSeparator || *ptr == ValueSeparator))
+            ++ptr;
+        error->error = QJsonParseError::NoError;
+        error->offset = ptr - json.constBegin();
+    }
+    return list;
+}
+
+bool QJsonVariantReader::validate(const QByteArray& json, QJsonParseError* error)
+{
+    QJsonVariantReader reader(json);
+    const bool valid = reader.validateValue();
+    if(error)
+        *error = reader.error();
+    return valid;
+}
+
+bool QJsonVariantReader::validate(QIODevice* device, QJsonParseError* error)
+{
+    QJsonVariantReader reader(device);
+    const bool valid = reader.validateValue();
+    if(error)
+        *error = reader.error();
+    return valid;
+}
+
+QVariantList QJsonVariantReader::extract(const QByteArray& json, const QStringList& pointers, QJsonParseError* error)
+{
+    QJsonVariantReader reader(json);
+    QVariantList values = reader.extract(pointers);
+    if(error)
+        *error = reader.error();
+    return values;
+}
@@ -4,16 +4,24 @@
 #include "qvariantreader.h"
 #include <QJsonParseError>
 
+class QThreadPool;
 class QJsonVariantReader: public QVariantReader
 {
 public:
-    explicit QJsonVariantReader(QIODevice *device);
+    enum { DefaultChunkSize = 64 * 1024, MinimumSliceSize = 256 * 1024 };
+
+    enum Engine : quint8 {
+        StreamingEngine = 0,
+        StructuralIndexEngine = 1
+    };
+
+    explicit QJsonVariantReader(QIODevice *device, qint64 chunkSize = DefaultChunkSize);
     explicit QJsonVariantReader(const QByteArray &data);
     virtual ~QJsonVariantReader();
     Q_DISABLE_COPY(QJsonVariantReader)
 
-    qint64 currentOffset() const final override { return ptr - json; }
-    qint64 totalSize() const final override { return m_buffer.size(); }
+    qint64 currentOffset() const final override { return m_offset + (ptr - json); }
+    qint64 totalSize() const final override { return m_size; }
 
     bool hasError() final override { return lastError() != QJsonParseError::NoError; };
     bool hasNext() const final override;
@@ -28,6 +36,9 @@ public:
     bool enterContainer() final override;
     bool leaveContainer() final override;
 
+    bool skipValue() final override;
+
+    QString readKey() final override;
     QVariant readValue() final override;
 
     QJsonParseError::ParseError lastError() const { return m_lastError; }
@@ -35,21 +46,54 @@ public:
     int errorCode() final override { return error().error; }
     QString errorString() final override { return error().errorString(); }
 
-    static QVariant fromJson(const QByteArray& json, QJsonParseError* error = nullptr);
+    static QVariant fromJson(const QByteArray& json, QJsonParseError* error = nullptr, Engine engine = StreamingEngine);
     static QVariant fromJson(QIODevice* device, QJsonParseError* error = nullptr);
+    static QVariant fromJsonParallel(const QByteArray& json, QJsonParseError* error = nullptr, QThreadPool* pool = nullptr);
+    static QVariantList extract(const QByteArray& json, const QStringList& pointers, QJsonParseError* error = nullptr);
+
+    static bool validate(const QByteArray& json, QJsonParseError* error = nullptr);
+    static bool validate(QIODevice* device, QJsonParseError* error = nullptr);
+
+protected:
+    bool matchKey(QStringView key) final override;
+    bool parseKey(QVariantHandler *handler) final override;
+    bool parseValue(QVariantHandler *handler) final override;
 
 private:
+    friend class QJsonFormatter;
+    friend class QJsonCborTranscoder;
+
+    bool fetchMore(const char *&keep);
+    inline bool hasMore(const char *&keep);
+    inline bool ensureAvailable(qint64 count);
+
     inline void skipByteOrderMark();
     inline bool skipWhitespace();
-    inline QString parseString();
+    bool scanString(const char *&start, bool &isUtf8);
+    inline bool skipString();
+    inline QString parseString(bool isKey = false);
+    inline bool parseString(QVariantHandler *handler, bool isKey);
+    bool scanNumber(const char *&start);
     inline QVariant parseNumber();
+    bool validateValue();
 
     QJsonParseError::ParseError m_lastError;
 
+    // When reading from a device, m_buffer is a sliding window over it:
+    // m_offset is the device position of json, and bytes before the
+    // token being parsed are discarded on each refill.
+    QIODevice *m_device;
+    qint64 m_chunkSize;
+    qint64 m_offset;
+    qint64 m_size;
+
     QByteArray m_buffer;
     const char *json;
     const char *ptr;
     const char *end;
+
+    // decoded escaped strings handed to a QVariantHandler
+    QString m_stringBuffer;
 };
 
 #endif // QJSONVARIANTREADER_H
@@ -1,88 +1,132 @@
 #include "qjsonvariantwriter.h"
-#include <QBuffer>
 #include <QIODevice>
-#include <QLocale>
+#include <QMetaProperty>
+#include <QVarLengthArray>
+#include <QThreadPool>
 
 #include "qutf8.h"
+#include "qjsonoutput.h"
+#include "qjsonnumber.h"
+#include "qparallelwriter.h"
+#include "qvariantpairlist.h"
 
-Q_GLOBAL_STATIC_WITH_ARGS(bool, g_showType, (false))
+static void variantToJson(const QVariant &value, QJsonOutput &d, int indent, bool compact, bool showType);
 
-static void variantToJson(const QVariant &value, QIODevice *d, int indent, bool compact);
-
-static inline void stringToJson(const QString &string, QIODevice *d)
+static inline void stringToJson(const QString &string, QJsonOutput &d)
 {
-    d->write("\"");
-    d->write(QUtf8::escapedString(string));
-    d->write("\"");
+    d.write('"');
+    d.writeEscaped(string);
+    d.write('"');
 }
 
-static inline void startArray(QIODevice *d, int& indent, bool compact)
+static inline void startArray(QJsonOutput &d, int& indent, bool compact)
 {
-    d->write(compact ? "[" : "[\n");
+    d.write(compact ? "[" : "[\n");
     indent = indent + (compact ? 0 : 1);
 }
-static inline void endArray(QIODevice *d, int& indent, bool compact)
+static inline void endArray(QJsonOutput &d, int& indent, bool compact)
 {
     indent = indent - (compact ? 0 : 1);
-    d->write(QByteArray(4*indent, ' '));
-    d->write((compact || indent) ? "]" : "]\n");
+    d.writeIndent(indent);
+    d.write((compact || indent) ? "]" : "]\n");
 }
 template<typename T>
-static inline void variantListToJson(const QList<T>& array, QIODevice *d, int indent, bool compact)
+static inline void variantListToJson(const QList<T>& array, QJsonOutput &d, int indent, bool compact, bool showType)
 {
-    QByteArray indentString(4*indent, ' ');
     qsizetype i = 0;
     for(const T& variant: array) {
-        d->write(indentString);
-        variantToJson(variant, d, indent, compact);
+        d.writeIndent(indent);
+        variantToJson(variant, d, indent, compact, showType);
         if (++i == array.size()) {
             if (!compact)
-                d->write("\n");
+                d.write('\n');
             break;
         }
-        d->write(compact ? "," : ",\n");
+        d.write(compact ? "," : ",\n");
     }
 }
 
-static inline void startMap(QIODevice *d, int& indent, bool compact)
+static inline void startMap(QJsonOutput &d, int& indent, bool compact)
 {
-    d->write(compact ? "{" : "{\n");
+    d.write(compact ? "{" : "{\n");
     indent = indent + (compact ? 0 : 1);
 }
-static inline void endMap(QIODevice *d, int& indent, bool compact)
+static inline void endMap(QJsonOutput &d, int& indent, bool compact)
 {
     indent = indent - (compact ? 0 : 1);
-    d->write(QByteArray(4*indent, ' '));
-    d->write((compact || indent) ? "}" : "}\n");
+    d.writeIndent(indent);
+    d.write((compact || indent) ? "}" : "}\n");
 }
 template<typename T>
-static inline void variantObjectToJson(const T& object, QIODevice *d, int indent, bool compact)
+static inline void variantObjectToJson(const T& object, QJsonOutput &d, int indent, bool compact, bool showType)
 {
-    QByteArray indentString(4*indent, ' ');
     qsizetype i = 0;
     auto it = object.begin();
     auto end = object.end();
     for ( ; it != end; ++it) {
-        d->write(indentString);
+        d.writeIndent(indent);
         stringToJson(it.key(), d);
-        d->write(compact ? ":" : ": ");
-        variantToJson(it.value(), d, indent, compact);
+        d.write(compact ? ":" : ": ");
+        variantToJson(it.value(), d, indent, compact, showType);
         if (++i == object.size()) {
             if (!compact)
-                d->write("\n");
+                d.write('\n');
             break;
         }
-        d->write(compact ? "," : ",\n");
+        d.write(compact ? "," : ",\n");
     }
 }
-static inline void variantValueToJson(const QVariant &value, QIODevice *d)
+static inline void variantObjectToJson(const QVariantPairList& object, QJsonOutput &d, int indent, bool compact, bool showType)
+{
+    qsizetype i = 0;
+    for (const auto &pair: object) {
+        d.writeIndent(indent);
+        stringToJson(pair.first, d);
+        d.write(compact ? ":" : ": ");
+        variantToJson(pair.second, d, indent, compact, showType);
+        if (++i == object.size()) {
+            if (!compact)
+                d.write('\n');
+            break;
+        }
+        d.write(compact ? "," : ",\n");
+    }
+}
+static inline void gadgetToJson(const void *gadget, const QMetaObject *metaObject, QJsonOutput &d, int indent, bool compact, bool showType)
+{
+    // written like a map, but in declaration order and straight from the
+    // properties
+    QVarLengthArray<QMetaProperty, 16> properties;
+    for (int i = 0; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty property = metaObject->property(i);
+        if (property.isReadable() && property.isStored())
+            properties.append(property);
+    }
+
+    qsizetype i = 0;
+    for (const QMetaProperty &property: properties) {
+        d.writeIndent(indent);
+        d.write('"');
+        d.write(property.name());
+        d.write('"');
+        d.write(compact ? ":" : ": ");
+        variantToJson(property.readOnGadget(gadget), d, indent, compact, showType);
+        if (++i == properties.size()) {
+            if (!compact)
+                d.write('\n');
+            break;
+        }
+        d.write(compact ? "," : ",\n");
+    }
+}
+static inline void variantValueToJson(const QVariant &value, QJsonOutput &d)
 {
     switch (value.metaType().id()) {
     case QMetaType::Bool:
         if(value.toBool())
-            d->write("true");
+            d.write("true");
         else
-            d->write("false");
+            d.write("false");
         break;
     case QMetaType::Short:
     case QMetaType::UShort:
@@ -90,12 +134,12 @@ static inline void variantValueToJson(const QVariant &value, QIODevice *d)
     case QMetaType::LongLong:
     case QMetaType::Long:
     case QMetaType::UInt:
-        d->write(QByteArray::number(value.toLongLong()));
+        d.writeNumber(value.toLongLong());
         break;
     case QMetaType::ULong:
     case QMetaType::ULongLong:
         if (value.toULongLong() <= static_cast<uint64_t>(std::numeric_limits<qint64>::max())) {
-            d->write(QByteArray::number(value.toULongLong()));
+            d.writeNumber(qint64(value.toULongLong()));
             break;
         }
         Q_FALLTHROUGH();
@@ -104,9 +148,9 @@ static inline void variantValueToJson(const QVariant &value, QIODevice *d)
     case QMetaType::Double: {
         const double val = value.toDouble();
         if (qIsFinite(val))
-            d->write(QByteArray::number(val, 'g', QLocale::FloatingPointShortest));
+            d.writeNumber(val);
         else
-            d->write("null"); // +INF || -INF || NaN (see RFC4627#section2.4)
+            d.write("null"); // +INF || -INF || NaN (see RFC4627#section2.4)
         break;
     }
     case QMetaType::Nullptr:
@@ -114,95 +158,387 @@ static inline void variantValueToJson(const QVariant &value, QIODevice *d)
     case QMetaType::QDateTime:
     default:
         if(value.isNull() || !value.isValid()) {
-            d->write("null");
+            d.write("null");
             break;
         }
         stringToJson(value.toString(), d);
         break;
     }
 }
-void variantToJson(const QVariant &value, QIODevice *d, int indent, bool compact)
+static inline void typeToJson(const QVariant &value, QJsonOutput &d, bool compact)
+{
+    d.write(compact ? "" : " ");
+    d.write(QString("(%1)").arg(value.metaType().name()).toUtf8());
+}
+void variantToJson(const QVariant &value, QJsonOutput &d, int indent, bool compact, bool showType)
 {
     switch (value.metaType().id()) {
     case QMetaType::QStringList: {
         startArray(d, indent, compact);
-        variantListToJson(value.toStringList(), d, indent, compact);
+        variantListToJson(value.toStringList(), d, indent, compact, showType);
         endArray(d, indent, compact);
         break;
     }
     case QMetaType::QVariantList: {
         startArray(d, indent, compact);
-        variantListToJson(value.toList(), d, indent, compact);
+        variantListToJson(value.toList(), d, indent, compact, showType);
         endArray(d, indent, compact);
         break;
     }
     case QMetaType::QVariantMap: {
         startMap(d, indent, compact);
-        variantObjectToJson(value.toMap(), d, indent, compact);
+        variantObjectToJson(value.toMap(), d, indent, compact, showType);
         endMap(d, indent, compact);
         break;
     }
     case QMetaType::QVariantHash: {
         startMap(d, indent, compact);
-        variantObjectToJson(value.toHash(), d, indent, compact);
+        variantObjectToJson(value.toHash(), d, indent, compact, showType);
         endMap(d, indent, compact);
         break;
     }
     default: {
+        if (value.metaType() == QMetaType::fromType<QVariantPairList>()) {
+            startMap(d, indent, compact);
+            variantObjectToJson(value.value<QVariantPairList>(), d, indent, compact, showType);
+            endMap(d, indent, compact);
+            break;
+        }
+        if (value.metaType().flags() & QMetaType::IsGadget) {
+            startMap(d, indent, compact);
+            gadgetToJson(value.constData(), value.metaType().metaObject(), d, indent, compact, showType);
+            endMap(d, indent, compact);
+            break;
+        }
         variantValueToJson(value, d);
         break;
     }
     }
 
-    if(*g_showType) {
-        d->write(compact ? "" : " ");
-        d->write(QString("(%1)").arg(value.metaType().name()).toUtf8());
+    if(showType)
+        typeToJson(value, d, compact);
+}
+
+// Parallel writing: the members of large containers are written in slices
+// on a thread pool, see QParallelWriter. Smaller containers are walked here
+// so that large ones further down are still split; everything else goes to
+// the sequential functions above.
+
+static void variantToJsonParallel(const QVariant &value, QJsonOutput &d, int indent, bool compact, bool showType, QThreadPool *pool);
+
+// Members [first, last) of a container of size members, from it on, each
+// written by member(d, it) and followed by its separator
+template<typename It, typename Member>
+static inline void membersToJson(It it, qsizetype first, qsizetype last, qsizetype size, QJsonOutput &d, int indent, bool compact, const Member &member)
+{
+    for (qsizetype i = first; i < last; ++i, ++it) {
+        d.writeIndent(indent);
+        member(d, it);
+        if (i + 1 == size) {
+            if (!compact)
+                d.write('\n');
+            break;
+        }
+        d.write(compact ? "," : ",\n");
+    }
+}
+// member(d, it, pool) writes a member; slices pass no pool, so their
+// members are written sequentially
+template<typename It, typename Member>
+static void membersToJsonParallel(It begin, qsizetype size, QJsonOutput &d, int indent, bool compact, QThreadPool *pool, const Member &member)
+{
+    const qsizetype sliceSize = QParallelWriter::sliceSize(size, pool);
+    if (sliceSize == 0) {
+        membersToJson(begin, 0, size, size, d, indent, compact, [&](QJsonOutput &out, It it) { member(out, it, pool); });
+        return;
+    }
+
+    const QList<It> starts = QParallelWriter::sliceStarts(begin, size, sliceSize);
+    const int indentWidth = d.indentWidth();
+    const char indentCharacter = d.indentCharacter();
+    QParallelWriter::writeSlices(starts.size(), pool, [&](qsizetype i, QByteArray *buffer) {
+        QJsonOutput out(buffer);
+        out.setIndentation(indentWidth, indentCharacter);
+        const qsizetype first = i * sliceSize;
+        membersToJson(starts.at(i), first, qMin(first + sliceSize, size), size, out, indent, compact,
+                      [&](QJsonOutput &o, It it) { member(o, it, nullptr); });
+    }, [&](const QByteArray &buffer) {
+        d.write(buffer);
+    });
+}
+void variantToJsonParallel(const QVariant &value, QJsonOutput &d, int indent, bool compact, bool showType, QThreadPool *pool)
+{
+    if (!pool) {
+        variantToJson(value, d, indent, compact, showType);
+        return;
+    }
+
+    // members are written at the indentation the start functions move to
+    const auto listMember = [&](QJsonOutput &out, auto it, QThreadPool *memberPool) {
+        variantToJsonParallel(*it, out, indent, compact, showType, memberPool);
+    };
+    const auto mapMember = [&](QJsonOutput &out, auto it, QThreadPool *memberPool) {
+        stringToJson(it.key(), out);
+        out.write(compact ? ":" : ": ");
+        variantToJsonParallel(it.value(), out, indent, compact, showType, memberPool);
+    };
+
+    switch (value.metaType().id()) {
+    case QMetaType::QStringList: {
+        const QStringList list = value.toStringList();
+        startArray(d, indent, compact);
+        membersToJsonParallel(list.begin(), list.size(), d, indent, compact, pool, listMember);
+        endArray(d, indent, compact);
+        break;
+    }
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        startArray(d, indent, compact);
+        membersToJsonParallel(list.begin(), list.size(), d, indent, compact, pool, listMember);
+        endArray(d, indent, compact);
+        break;
+    }
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        startMap(d, indent, compact);
+        membersToJsonParallel(map.begin(), map.size(), d, indent, compact, pool, mapMember);
+        endMap(d, indent, compact);
+        break;
+    }
+    case QMetaType::QVariantHash: {
+        const QVariantHash hash = value.toHash();
+        startMap(d, indent, compact);
+        membersToJsonParallel(hash.begin(), hash.size(), d, indent, compact, pool, mapMember);
+        endMap(d, indent, compact);
+        break;
+    }
+    default: {
+        if (value.metaType() == QMetaType::fromType<QVariantPairList>()) {
+            const QVariantPairList pairs = value.value<QVariantPairList>();
+            startMap(d, indent, compact);
+            membersToJsonParallel(pairs.begin(), pairs.size(), d, indent, compact, pool,
+                                  [&](QJsonOutput &out, QVariantPairList::const_iterator it, QThreadPool *memberPool) {
+                stringToJson(it->first, out);
+                out.write(compact ? ":" : ": ");
+                variantToJsonParallel(it->second, out, indent, compact, showType, memberPool);
+            });
+            endMap(d, indent, compact);
+            break;
+        }
+        variantToJson(value, d, indent, compact, showType);
+        return;
+    }
+    }
+
+    if(showType)
+        typeToJson(value, d, compact);
+}
+
+// Sizing pass: the exact number of bytes the functions above write without
+// type names, for indentWidth bytes per level of indentation.
+
+static qsizetype variantJsonSize(const QVariant &value, int indent, bool compact, int indentWidth);
+
+static inline qsizetype stringJsonSize(QStringView string)
+{
+    return 2 + QUtf8::escapedSize(string.utf16(), string.utf16() + string.size());
+}
+// startArray() and endArray(), or startMap() and endMap(), at indent
+static inline qsizetype containerJsonSize(int indent, bool compact, int indentWidth)
+{
+    if (compact)
+        return 2;
+    return 2 + qsizetype(indent) * indentWidth + (indent ? 1 : 2);
+}
+// The indentation and separators around count members at indent
+static inline qsizetype membersJsonSize(qsizetype count, int indent, bool compact, int indentWidth)
+{
+    if (count == 0)
+        return 0;
+    if (compact)
+        return count - 1;
+    return count * (qsizetype(indent) * indentWidth + 2) - 1;
+}
+template<typename T>
+static inline qsizetype variantListJsonSize(const QList<T>& array, int indent, bool compact, int indentWidth)
+{
+    qsizetype size = membersJsonSize(array.size(), indent, compact, indentWidth);
+    for(const T& variant: array)
+        size += variantJsonSize(variant, indent, compact, indentWidth);
+    return size;
+}
+template<typename T>
+static inline qsizetype variantObjectJsonSize(const T& object, int indent, bool compact, int indentWidth)
+{
+    qsizetype size = membersJsonSize(object.size(), indent, compact, indentWidth);
+    auto it = object.begin();
+    auto end = object.end();
+    for ( ; it != end; ++it) {
+        size += stringJsonSize(it.key()) + (compact ? 1 : 2);
+        size += variantJsonSize(it.value(), indent, compact, indentWidth);
+    }
+    return size;
+}
+static inline qsizetype variantObjectJsonSize(const QVariantPairList& object, int indent, bool compact, int indentWidth)
+{
+    qsizetype size = membersJsonSize(object.size(), indent, compact, indentWidth);
+    for (const auto &pair: object) {
+        size += stringJsonSize(pair.first) + (compact ? 1 : 2);
+        size += variantJsonSize(pair.second, indent, compact, indentWidth);
+    }
+    return size;
+}
+static inline qsizetype gadgetJsonSize(const void *gadget, const QMetaObject *metaObject, int indent, bool compact, int indentWidth)
+{
+    qsizetype size = 0;
+    qsizetype count = 0;
+    for (int i = 0; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty property = metaObject->property(i);
+        if (!property.isReadable() || !property.isStored())
+            continue;
+        ++count;
+        size += 2 + qsizetype(::strlen(property.name())) + (compact ? 1 : 2);
+        size += variantJsonSize(property.readOnGadget(gadget), indent, compact, indentWidth);
+    }
+    return size + membersJsonSize(count, indent, compact, indentWidth);
+}
+static inline qsizetype variantValueJsonSize(const QVariant &value)
+{
+    switch (value.metaType().id()) {
+    case QMetaType::Bool:
+        return value.toBool() ? 4 : 5;
+    case QMetaType::Short:
+    case QMetaType::UShort:
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+    case QMetaType::Long:
+    case QMetaType::UInt:
+        return QJsonNumber::integerLength(value.toLongLong());
+    case QMetaType::ULong:
+    case QMetaType::ULongLong:
+        if (value.toULongLong() <= static_cast<uint64_t>(std::numeric_limits<qint64>::max()))
+            return QJsonNumber::integerLength(qint64(value.toULongLong()));
+        Q_FALLTHROUGH();
+    case QMetaType::Float16:
+    case QMetaType::Float:
+    case QMetaType::Double: {
+        const double val = value.toDouble();
+        return qIsFinite(val) ? QJsonNumber::doubleLength(val) : 4;
+    }
+    default:
+        if(value.isNull() || !value.isValid())
+            return 4;
+        return stringJsonSize(value.toString());
+    }
+}
+qsizetype variantJsonSize(const QVariant &value, int indent, bool compact, int indentWidth)
+{
+    const int inner = indent + (compact ? 0 : 1);
+    switch (value.metaType().id()) {
+    case QMetaType::QStringList:
+        return containerJsonSize(indent, compact, indentWidth) + variantListJsonSize(value.toStringList(), inner, compact, indentWidth);
+    case QMetaType::QVariantList:
+        return containerJsonSize(indent, compact, indentWidth) + variantListJsonSize(value.toList(), inner, compact, indentWidth);
+    case QMetaType::QVariantMap:
+        return containerJsonSize(indent, compact, indentWidth) + variantObjectJsonSize(value.toMap(), inner, compact, indentWidth);
+    case QMetaType::QVariantHash:
+        return containerJsonSize(indent, compact, indentWidth) + variantObjectJsonSize(value.toHash(), inner, compact, indentWidth);
+    default:
+        if (value.metaType() == QMetaType::fromType<QVariantPairList>())
+            return containerJsonSize(indent, compact, indentWidth) + variantObjectJsonSize(value.value<QVariantPairList>(), inner, compact, indentWidth);
+        if (value.metaType().flags() & QMetaType::IsGadget)
+            return containerJsonSize(indent, compact, indentWidth) + gadgetJsonSize(value.constData(), value.metaType().metaObject(), inner, compact, indentWidth);
+        return variantValueJsonSize(value);
     }
 }
 
 QJsonVariantWriter::QJsonVariantWriter(QIODevice *device, bool compact):
-    m_device(device),
-    m_deleteDevice(false),
+    m_output(new QJsonOutput(device)),
     m_compact(compact),
-    m_indent(0)
+    m_indent(0),
+    m_showType(false),
+    m_threadPool(nullptr)
 {
-    *g_showType = false;
+
 }
 
 QJsonVariantWriter::QJsonVariantWriter(QByteArray *data, bool compact):
-    QJsonVariantWriter(new QBuffer(data), compact)
+    m_output(new QJsonOutput(data)),
+    m_compact(compact),
+    m_indent(0),
+    m_showType(false),
+    m_threadPool(nullptr)
 {
-    m_device->open(QIODevice::WriteOnly | QIODevice::Unbuffered);
-    m_deleteDevice = true;
+
 }
 
 QJsonVariantWriter::~QJsonVariantWriter()
 {
-    if (m_deleteDevice)
-        delete m_device;
+    delete m_output;
 }
 
 void QJsonVariantWriter::start()
 {
-    *g_showType = false;
-    m_device->open(QIODevice::WriteOnly | QIODevice::Unbuffered);
+    // the writer buffers, the device does not need to
+    if (m_output->device())
+        m_output->device()->open(QIODevice::WriteOnly | QIODevice::Unbuffered);
     m_indent = 0;
 }
+void QJsonVariantWriter::flush()
+{
+    m_output->flush();
+}
+qsizetype QJsonVariantWriter::flushSize() const
+{
+    return m_output->flushSize();
+}
+void QJsonVariantWriter::setFlushSize(qsizetype size)
+{
+    m_output->setFlushSize(size);
+}
+int QJsonVariantWriter::indentWidth() const
+{
+    return m_output->indentWidth();
+}
+char QJsonVariantWriter::indentCharacter() const
+{
+    return m_output->indentCharacter();
+}
+void QJsonVariantWriter::setIndentation(int width, char character)
+{
+    m_output->setIndentation(width, character);
+}
+bool QJsonVariantWriter::showType() const
+{
+    return m_showType;
+}
+void QJsonVariantWriter::setShowType(bool showType)
+{
+    m_showType = showType;
+}
+QThreadPool *QJsonVariantWriter::threadPool() const
+{
+    return m_threadPool;
+}
+void QJsonVariantWriter::setThreadPool(QThreadPool *pool)
+{
+    m_threadPool = pool;
+}
 void QJsonVariantWriter::startArray()
 {
-    ::startArray(m_device, m_indent, m_compact);
+    ::startArray(*m_output, m_indent, m_compact);
 }
 void QJsonVariantWriter::endArray()
 {
-    ::endArray(m_device, m_indent, m_compact);
+    ::endArray(*m_output, m_indent, m_compact);
 }
 void QJsonVariantWriter::startMap()
 {
-    ::startMap(m_device, m_indent, m_compact);
+    ::startMap(*m_output, m_indent, m_compact);
 }
 void QJsonVariantWriter::endMap()
 {
-    ::endMap(m_device, m_indent, m_compact);
+    ::endMap(*m_output, m_indent, m_compact);
 }
 
 void QJsonVariantWriter::writeKeyValue(QStringView key, const QVariant& value)
@@ -213,43 +549,53 @@ void QJsonVariantWriter::writeKeyValue(QStringView key, const QVariant& value)
 }
 void QJsonVariantWriter::writeNameSeparator()
 {
-    m_device->write(m_compact ? ":" : ": ");
+    m_output->write(m_compact ? ":" : ": ");
 }
 void QJsonVariantWriter::writeValueSeparator()
 {
-    m_device->write(m_compact ? "," : ",\n");
+    m_output->write(m_compact ? "," : ",\n");
 }
 
 void QJsonVariantWriter::writeString(QStringView s)
 {
-    m_device->write("\"");
-    m_device->write(QUtf8::escapedString(s));
-    m_device->write("\"");
+    m_output->write('"');
+    m_output->writeEscaped(s);
+    m_output->write('"');
 }
 void QJsonVariantWriter::writeRaw(const char *data, qint64 len)
 {
-    m_device->write(data, len);
+    m_output->write(data, len);
 }
 void QJsonVariantWriter::writeRaw(const char *data)
 {
-    m_device->write(data);
+    m_output->write(data);
 }
 void QJsonVariantWriter::writeRaw(const QByteArray &data)
 {
-    m_device->write(data);
+    m_output->write(data);
 }
 void QJsonVariantWriter::writeVariant(const QVariant &v)
 {
-    ::variantToJson(v, m_device, m_indent, m_compact);
+    ::variantToJsonParallel(v, *m_output, m_indent, m_compact, m_showType, m_threadPool);
 }
 
-QByteArray QJsonVariantWriter::fromVariant(const QVariant& variant, bool compact)
+void QJsonVariantWriter::writeGadget(const void *gadget, const QMetaObject *metaObject)
+{
+    ::startMap(*m_output, m_indent, m_compact);
+    ::gadgetToJson(gadget, metaObject, *m_output, m_indent, m_compact, m_showType);
+    ::endMap(*m_output, m_indent, m_compact);
+}
+
+QByteArray QJsonVariantWriter::fromVariant(const QVariant& variant, bool compact, bool exactSize)
 {
     QByteArray json;
+    if (exactSize)
+        json.reserve(serializedSize(variant, compact));
     QJsonVariantWriter writer(&json, compact);
 
     writer.start();
     writer.writeVariant(variant);
+    writer.flush();
 
     json.squeeze();
 
@@ -264,6 +610,35 @@ void QJsonVariantWriter::fromVariant(const QVariant& variant, QIODevice* device,
     writer.writeVariant(variant);
 }
 
+QByteArray QJsonVariantWriter::fromVariantParallel(const QVariant& variant, bool compact, QThreadPool* pool)
+{
+    QByteArray json;
+    QJsonVariantWriter writer(&json, compact);
+    writer.setThreadPool(pool ? pool : QThreadPool::globalInstance());
+
+    writer.start();
+    writer.writeVariant(variant);
+    writer.flush();
+
+    json.squeeze();
+
+    return json;
+}
+
+void QJsonVariantWriter::fromVariantParallel(const QVariant& variant, QIODevice* device, bool compact, QThreadPool* pool)
+{
+    QJsonVariantWriter writer(device, compact);
+    writer.setThreadPool(pool ? pool : QThreadPool::globalInstance());
+
+    writer.start();
+    writer.writeVariant(variant);
+}
+
+qsizetype QJsonVariantWriter::serializedSize(const QVariant& variant, bool compact)
+{
+    return variantJsonSize(variant, 0, compact, 4);
+}
+
 QByteArray QJsonVariantWriter::escapedString(QStringView s)
 {
     return QUtf8::escapedString(s);
@@ -274,14 +649,15 @@ QByteArray QJsonVariantWriter::fromVariantDebug(const QVariant& variant, bool co
     QByteArray json;
     QJsonVariantWriter writer(&json, compact);
 
+    writer.setShowType(true);
     writer.start();
-    *g_showType = true;
     writer.writeRaw("\n");
     writer.writeRaw(QByteArray(100,'-'));
     writer.writeRaw("\n");
     writer.writeVariant(variant);
     writer.writeRaw("\n");
     writer.writeRaw(QByteArray(100,'-'));
+    writer.flush();
 
     json.squeeze();
 
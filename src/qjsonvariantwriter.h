@@ -3,8 +3,17 @@
 
 #include <QVariant>
 #include <QByteArray>
+#include <QMetaObject>
 
 class QIODevice;
+class QThreadPool;
+class QJsonOutput;
+
+// Output is buffered: it reaches the device, or the QByteArray gets its
+// final size, on flush() or when the writer is destroyed.
+//
+// A writer keeps all of its state, so writers on different threads do not
+// interfere; a single writer is not thread-safe.
 class QJsonVariantWriter
 {
 public:
@@ -14,6 +23,27 @@ public:
     Q_DISABLE_COPY(QJsonVariantWriter)
 
     void start();
+    void flush();
+
+    qsizetype flushSize() const;
+    void setFlushSize(qsizetype size);
+
+    // Indentation of the indented form, four spaces per level by default;
+    // the character is a space or a tab.
+    int indentWidth() const;
+    char indentCharacter() const;
+    void setIndentation(int width, char character = ' ');
+
+    // Follow each value with its type name, as fromVariantDebug() does.
+    bool showType() const;
+    void setShowType(bool showType);
+
+    // With a pool, the members of large lists and maps are written in
+    // slices on it, with the same result; without one, the default, the
+    // writer stays on the calling thread.
+    QThreadPool *threadPool() const;
+    void setThreadPool(QThreadPool *pool);
+
     void startArray();
     void endArray();
     void startMap();
@@ -29,18 +59,30 @@ public:
     void writeRaw(const QByteArray &ba);
     void writeVariant(const QVariant &v);
 
-    static QByteArray fromVariant(const QVariant& variant, bool compact = true);
+    template<typename T>
+    void writeGadget(const T &gadget) { writeGadget(&gadget, &T::staticMetaObject); }
+    void writeGadget(const void *gadget, const QMetaObject *metaObject);
+
+    // With exactSize, the result is measured with serializedSize() first
+    // and written into a single allocation of that size.
+    static QByteArray fromVariant(const QVariant& variant, bool compact = true, bool exactSize = false);
     static void fromVariant(const QVariant& variant, QIODevice* device, bool compact = true);
+    static QByteArray fromVariantParallel(const QVariant& variant, bool compact = true, QThreadPool* pool = nullptr);
+    static void fromVariantParallel(const QVariant& variant, QIODevice* device, bool compact = true, QThreadPool* pool = nullptr);
+
+    // The number of bytes fromVariant() writes, without writing them.
+    static qsizetype serializedSize(const QVariant& variant, bool compact = true);
 
     static QByteArray escapedString(QStringView s);
     static QByteArray fromVariantDebug(const QVariant& variant, bool compact = true);
 
 private:
-    QIODevice *m_device;
-    bool m_deleteDevice;
+    QJsonOutput *m_output;
 
     bool m_compact;
     int m_indent;
+    bool m_showType;
+    QThreadPool *m_threadPool;
 };
 
 #endif // QJSONVARIANTWRITER_H
@@ -0,0 +1,78 @@
+#ifndef QPARALLELWRITER_H
+#define QPARALLELWRITER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThreadPool>
+#include <iterator>
+#include <vector>
+
+// Slicing for the parallel writers: the members of a large container are
+// written in slices, each into its own buffer, and the buffers are copied
+// out in member order, so the result is the same as a sequential write.
+namespace QParallelWriter {
+
+enum { MinimumSliceSize = 1024 };
+
+// How many members to put in each slice of a container of size members,
+// or 0 when the container is too small to be worth splitting.
+inline qsizetype sliceSize(qsizetype size, QThreadPool *pool)
+{
+    const int threads = pool->maxThreadCount();
+    const qsizetype members = qMax<qsizetype>(size / (4 * qMax(threads, 1)), MinimumSliceSize);
+    if (threads < 2 || size < 2 * members)
+        return 0;
+    return members;
+}
+
+// The first member of each slice, found by walking the container once.
+template<typename It>
+QList<It> sliceStarts(It begin, qsizetype size, qsizetype sliceSize)
+{
+    QList<It> starts;
+    for (qsizetype first = 0; first < size; first += sliceSize) {
+        starts.append(begin);
+        if (first + sliceSize < size)
+            std::advance(begin, sliceSize);
+    }
+    return starts;
+}
+
+// Runs writeSlice(i, &buffer) for the count slices on pool and hands the
+// buffers to output(buffer) in order, each as soon as it and the ones before
+// it are done. While it waits, the calling thread runs the slices the pool
+// has not started, so this also makes progress on a busy pool.
+template<typename WriteSlice, typename Output>
+void writeSlices(qsizetype count, QThreadPool *pool, WriteSlice writeSlice, Output output)
+{
+    // sized once: the workers fill their own element in place
+    QList<QByteArray> buffers(count);
+    QByteArray *buffer = buffers.data();
+    std::vector<QSemaphore> done(count);
+    QList<QRunnable *> runnables(count);
+    for (qsizetype i = 0; i < count; ++i) {
+        QByteArray *sliceBuffer = buffer + i;
+        QSemaphore *finished = done.data() + i;
+        runnables[i] = QRunnable::create([&writeSlice, i, sliceBuffer, finished]() {
+            writeSlice(i, sliceBuffer);
+            finished->release();
+        });
+        runnables[i]->setAutoDelete(false);
+        pool->start(runnables[i]);
+    }
+
+    for (qsizetype i = 0; i < count; ++i) {
+        if (pool->tryTake(runnables[i]))
+            runnables[i]->run();
+        done[i].acquire();
+        output(buffer[i]);
+        buffer[i] = QByteArray();
+    }
+    qDeleteAll(runnables);
+}
+
+} // namespace QParallelWriter
+
+#endif // QPARALLELWRITER_H
@@ -2,6 +2,9 @@
 #define QUTF8_H
 
 #include <QString>
+#include <QStringDecoder>
+
+#include "qjsonscanner.h"
 
 namespace QUtf8 {
 
@@ -13,173 +16,328 @@ static inline uchar hexdig(uint u)
 {
     return (u < 0xa ? '0' + u : 'a' + u - 0xa);
 }
-static QByteArray escapedString(QStringView s)
-{
-    QByteArray ba(qMax(s.size(), 16), Qt::Uninitialized);
-    auto ba_const_start = [&]() { return reinterpret_cast<const uchar *>(ba.constData()); };
-    uchar *cursor = reinterpret_cast<uchar *>(const_cast<char *>(ba.constData()));
-    const uchar *ba_end = cursor + ba.size();
+// Room escapeString() needs per UTF-16 unit: a control character becomes
+// a six byte \u00XX escape.
+enum { MaxEscapedUnitSize = 6 };
 
-    const char16_t *src = s.utf16();
-    const char16_t *const end = s.utf16() + s.size();
-
-    auto ensureCapacity = [&](int extra) {
-        if (cursor + extra >= ba_end) {
-            qptrdiff pos = cursor - ba_const_start();
-            ba.resize(ba.size() * 2 + extra);
-            cursor = reinterpret_cast<uchar *>(ba.data()) + pos;
-            ba_end = ba_const_start() + ba.size();
-        }
-    };
-
-    while (src != end) {
-        if (cursor >= ba_end - 6) {
-            // ensure we have enough space
-            qptrdiff pos = cursor - ba_const_start();
-            ba.resize(ba.size() * 2);
-            cursor = reinterpret_cast<uchar *>(ba.data()) + pos;
-            ba_end = ba_const_start() + ba.size();
-        }
+// Writes [src, end) as the body of a JSON string at dst and returns the
+// end of what was written; dst must have room for MaxEscapedUnitSize bytes
+// per unit. Runs of printable ASCII are narrowed in bulk, the rest is
+// escaped or encoded as UTF-8 one code point at a time. A high surrogate
+// ending the range is encoded as U+FFFD, see escapeChunkEnd().
+static inline char *escapeString(const char16_t *src, const char16_t *end, char *dst)
+{
+    uchar *cursor = reinterpret_cast<uchar *>(dst);
+    while (true) {
+        const qsizetype ascii = QJsonScanner::narrowAscii(src, end, reinterpret_cast<char *>(cursor));
+        src += ascii;
+        cursor += ascii;
+        if (src == end)
+            break;
 
         char16_t u = *src++;
         if (u < 0x80) {
-            if (u < 0x20 || u == 0x22 || u == 0x5c) {
-                ensureCapacity(6);
+            *cursor++ = '\\';
+            switch (u) {
+            case 0x22:
+                *cursor++ = '"';
+                break;
+            case 0x5c:
                 *cursor++ = '\\';
-                switch (u) {
-                case 0x22:
-                    *cursor++ = '"';
-                    break;
-                case 0x5c:
-                    *cursor++ = '\\';
-                    break;
-                case 0x08:
-                    *cursor++ = 'b';
-                    break;
-                case 0x0c:
-                    *cursor++ = 'f';
-                    break;
-                case 0x0a:
-                    *cursor++ = 'n';
-                    break;
-                case 0x0d:
-                    *cursor++ = 'r';
-                    break;
-                case 0x09:
-                    *cursor++ = 't';
-                    break;
-                default:
-                    *cursor++ = 'u';
-                    *cursor++ = '0';
-                    *cursor++ = '0';
-                    *cursor++ = hexdig(u >> 4);
-                    *cursor++ = hexdig(u & 0xf);
-                }
-            } else {
-                ensureCapacity(1);
-                *cursor++ = (uchar) u;
+                break;
+            case 0x08:
+                *cursor++ = 'b';
+                break;
+            case 0x0c:
+                *cursor++ = 'f';
+                break;
+            case 0x0a:
+                *cursor++ = 'n';
+                break;
+            case 0x0d:
+                *cursor++ = 'r';
+                break;
+            case 0x09:
+                *cursor++ = 't';
+                break;
+            default:
+                *cursor++ = 'u';
+                *cursor++ = '0';
+                *cursor++ = '0';
+                *cursor++ = hexdig(u >> 4);
+                *cursor++ = hexdig(u & 0xf);
             }
-        } else {
-            if (u >= 0xD800 && u <= 0xDBFF) {
-                // high surrogate
-                if (src < end) {
-                    char16_t low = *src;
-                    if (low >= 0xDC00 && low <= 0xDFFF) {
-                        ++src;
-                        // Valid surrogate pair
-                        char32_t cp = 0x10000 + (((u - 0xD800) << 10) | (low - 0xDC00));
-                        ensureCapacity(4);
-                        *cursor++ = 0xF0 | (cp >> 18);
-                        *cursor++ = 0x80 | ((cp >> 12) & 0x3F);
-                        *cursor++ = 0x80 | ((cp >> 6) & 0x3F);
-                        *cursor++ = 0x80 | (cp & 0x3F);
-                        continue;
-                    }
+            continue;
+        }
+
+        if (u >= 0xD800 && u <= 0xDBFF) {
+            // high surrogate
+            if (src < end) {
+                char16_t low = *src;
+                if (low >= 0xDC00 && low <= 0xDFFF) {
+                    ++src;
+                    // Valid surrogate pair
+                    char32_t cp = 0x10000 + (((u - 0xD800) << 10) | (low - 0xDC00));
+                    *cursor++ = 0xF0 | (cp >> 18);
+                    *cursor++ = 0x80 | ((cp >> 12) & 0x3F);
+                    *cursor++ = 0x80 | ((cp >> 6) & 0x3F);
+                    *cursor++ = 0x80 | (cp & 0x3F);
+                    continue;
                 }
-                // Invalid surrogate, encode as \uFFFD
-                u = 0xFFFD;
-            } else if (u >= 0xDC00 && u <= 0xDFFF) {
-                // Lone low surrogate – invalid
-                u = 0xFFFD;
             }
+            // Invalid surrogate, encode as \uFFFD
+            u = 0xFFFD;
+        } else if (u >= 0xDC00 && u <= 0xDFFF) {
+            // Lone low surrogate – invalid
+            u = 0xFFFD;
+        }
+
+        // Encode BMP character (0x80 - 0xFFFF, not part of surrogate pair)
+        if (u <= 0x7FF) {
+            *cursor++ = 0xC0 | (u >> 6);
+            *cursor++ = 0x80 | (u & 0x3F);
+        } else {
+            *cursor++ = 0xE0 | (u >> 12);
+            *cursor++ = 0x80 | ((u >> 6) & 0x3F);
+            *cursor++ = 0x80 | (u & 0x3F);
+        }
+    }
+    return reinterpret_cast<char *>(cursor);
+}
 
-            // Encode BMP character (0x80 - 0xFFFF, not part of surrogate pair)
-            if (u <= 0x7FF) {
-                ensureCapacity(2);
-                *cursor++ = 0xC0 | (u >> 6);
-                *cursor++ = 0x80 | (u & 0x3F);
-            } else {
-                ensureCapacity(3);
-                *cursor++ = 0xE0 | (u >> 12);
-                *cursor++ = 0x80 | ((u >> 6) & 0x3F);
-                *cursor++ = 0x80 | (u & 0x3F);
+// How many bytes escapeString() writes for [src, end).
+static inline qsizetype escapedSize(const char16_t *src, const char16_t *end)
+{
+    qsizetype size = 0;
+    while (true) {
+        const qsizetype ascii = QJsonScanner::countAscii(src, end);
+        src += ascii;
+        size += ascii;
+        if (src == end)
+            break;
+
+        const char16_t u = *src++;
+        if (u < 0x80) {
+            switch (u) {
+            case 0x22:
+            case 0x5c:
+            case 0x08:
+            case 0x0c:
+            case 0x0a:
+            case 0x0d:
+            case 0x09:
+                size += 2;
+                break;
+            default:
+                size += 6;
             }
+        } else if (u <= 0x7FF) {
+            size += 2;
+        } else if (u >= 0xD800 && u <= 0xDBFF && src < end && *src >= 0xDC00 && *src <= 0xDFFF) {
+            ++src;
+            size += 4;
+        } else {
+            // includes lone surrogates, written as U+FFFD
+            size += 3;
         }
     }
+    return size;
+}
 
-    ba.resize(cursor - ba_const_start());
+// How many bytes [src, end) takes as UTF-8, or -1 if it holds a lone
+// surrogate, which encoders replace in their own way.
+static inline qsizetype utf8Size(const char16_t *src, const char16_t *end)
+{
+    qsizetype size = 0;
+    while (true) {
+        // what JSON escapes is still a single byte here
+        const qsizetype ascii = QJsonScanner::countAscii(src, end);
+        src += ascii;
+        size += ascii;
+        if (src == end)
+            break;
+
+        const char16_t u = *src++;
+        if (u < 0x80) {
+            size += 1;
+        } else if (u <= 0x7FF) {
+            size += 2;
+        } else if (u < 0xD800 || u > 0xDFFF) {
+            size += 3;
+        } else if (u <= 0xDBFF && src < end && *src >= 0xDC00 && *src <= 0xDFFF) {
+            ++src;
+            size += 4;
+        } else {
+            return -1;
+        }
+    }
+    return size;
+}
+
+// Where to end the next piece of [src, end) escaped on its own, so the
+// room reserved for it stays bounded; a surrogate pair is never split.
+static inline const char16_t *escapeChunkEnd(const char16_t *src, const char16_t *end, qsizetype chunkSize = 4096)
+{
+    if (end - src <= chunkSize)
+        return end;
+    const char16_t *stop = src + chunkSize;
+    if (stop[-1] >= 0xD800 && stop[-1] <= 0xDBFF)
+        --stop;
+    return stop;
+}
+
+static QByteArray escapedString(QStringView s)
+{
+    QByteArray ba;
+    qsizetype size = 0;
+    const char16_t *src = s.utf16();
+    const char16_t *const end = src + s.size();
+    while (src < end) {
+        const char16_t *stop = escapeChunkEnd(src, end);
+        ba.resize(size + MaxEscapedUnitSize * (stop - src));
+        size = escapeString(src, stop, ba.data() + size) - ba.constData();
+        src = stop;
+    }
+    ba.resize(size);
     return ba;
 }
 
-static inline QString unescapedString(const QByteArray &ba)
+static inline int hexValue(char c)
 {
-    QByteArray decoded;
-    decoded.reserve(ba.size());
-    const char *src = ba.constData();
-    const char *end = src + ba.size();
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 0xa;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 0xa;
+    return -1;
+}
+
+// Decodes a JSON string body in one pass, straight into UTF-16: ASCII runs
+// are widened in bulk, escapes are decoded inline and multi-byte sequences
+// go through the UTF-8 decoder. The two halves of an escaped surrogate pair
+// are written next to each other and so combine into one code point.
+static inline void unescapedString(const char *src, const char *end, QString &string)
+{
+    // a UTF-8 byte never decodes to more than one UTF-16 unit; resizing
+    // keeps the capacity, so a reused buffer does not allocate
+    string.resize(end - src);
+    char16_t *const begin = reinterpret_cast<char16_t *>(string.data());
+    char16_t *out = begin;
+    QStringDecoder decoder(QStringDecoder::Utf8, QStringDecoder::Flag::Stateless);
 
     while (src < end) {
-        if (*src == '\\' && src + 1 < end) {
-            ++src;
-            switch (*src) {
-            case 'b':
-                decoded.append('\b');
-                break;
-            case 'f':
-                decoded.append('\f');
-                break;
-            case 'n':
-                decoded.append('\n');
-                break;
-            case 'r':
-                decoded.append('\r');
-                break;
-            case 't':
-                decoded.append('\t');
-                break;
-            case '"':
-                decoded.append('\"');
-                break;
-            case '\\':
-                decoded.append('\\');
-                break;
-            case 'u':
-                if (src + 4 < end) {
-                    bool ok = false;
-                    ushort u = QByteArray(src + 1, 4).toUShort(&ok, 16);
-                    if (ok) {
-                        decoded.append(QString(QChar(u)).toUtf8());
-                        src += 4;
-                        break;
-                    }
+        const qsizetype ascii = QJsonScanner::widenAscii(src, end, out);
+        src += ascii;
+        out += ascii;
+        if (src == end)
+            break;
+
+        if (*src != '\\') {
+            const char *run = src;
+            while (src < end && uchar(*src) >= 0x80)
+                ++src;
+            out = decoder.appendToBuffer(out, QByteArrayView(run, src - run));
+            continue;
+        }
+
+        if (++src == end) {
+            *out++ = u'\\';
+            break;
+        }
+
+        switch (*src) {
+        case 'b':
+            *out++ = u'\b';
+            break;
+        case 'f':
+            *out++ = u'\f';
+            break;
+        case 'n':
+            *out++ = u'\n';
+            break;
+        case 'r':
+            *out++ = u'\r';
+            break;
+        case 't':
+            *out++ = u'\t';
+            break;
+        case 'u':
+            if (end - src > 4) {
+                const int d0 = hexValue(src[1]);
+                const int d1 = hexValue(src[2]);
+                const int d2 = hexValue(src[3]);
+                const int d3 = hexValue(src[4]);
+                if ((d0 | d1 | d2 | d3) >= 0) {
+                    *out++ = char16_t((d0 << 12) | (d1 << 8) | (d2 << 4) | d3);
+                    src += 4;
+                    break;
                 }
-                // if not valid \uXXXX, fall through and treat literally
-                decoded.append('\\');
-                decoded.append('u');
-                break;
-            default:
-                decoded.append(*src);
-                break;
             }
-        } else {
-            decoded.append(*src);
+            // if not valid \uXXXX, treat literally
+            *out++ = u'\\';
+            *out++ = u'u';
+            break;
+        default:
+            // '"', '\\', '/' and anything else stand for themselves; a
+            // multi-byte sequence is left to the decoder
+            if (uchar(*src) >= 0x80)
+                continue;
+            *out++ = uchar(*src);
+            break;
         }
         ++src;
     }
 
-    decoded.squeeze();
+    string.resize(out - begin);
+}
+
+static inline QString unescapedString(const char *src, const char *end)
+{
+    QString string;
+    unescapedString(src, end, string);
+    return string;
+}
 
-    return QString::fromUtf8(decoded);
+// Whether [src, end) is well-formed UTF-8: no overlong forms, surrogates or
+// code points past U+10FFFF.
+static inline bool isValidUtf8(const char *src, const char *end)
+{
+    while (src < end) {
+        const uchar b = *src;
+        if (b < 0x80) {
+            ++src;
+            continue;
+        }
+
+        qsizetype count;
+        char32_t c;
+        if (b >= 0xc2 && b <= 0xdf) {
+            count = 1;
+            c = b & 0x1f;
+        } else if (b >= 0xe0 && b <= 0xef) {
+            count = 2;
+            c = b & 0x0f;
+        } else if (b >= 0xf0 && b <= 0xf4) {
+            count = 3;
+            c = b & 0x07;
+        } else {
+            return false;
+        }
+        if (end - src <= count)
+            return false;
+        for (qsizetype i = 1; i <= count; ++i) {
+            const uchar next = src[i];
+            if ((next & 0xc0) != 0x80)
+                return false;
+            c = (c << 6) | (next & 0x3f);
+        }
+        if ((count == 2 && c < 0x800) || (count == 3 && (c < 0x10000 || c > 0x10ffff)) ||
+            (c >= 0xd800 && c <= 0xdfff))
+            return false;
+        src += count + 1;
+    }
+    return true;
 }
 } // namespace QUtf8
 
@@ -0,0 +1,35 @@
+#ifndef QVARIANTHANDLER_H
+#define QVARIANTHANDLER_H
+
+#include <QVariant>
+#include <QAnyStringView>
+
+// Receives the values of a document as QVariantReader::parse() reads them,
+// without building a QVariant tree. Strings are views that are only valid
+// during the call: they point into the input when it holds the string as
+// is (UTF-8, without escapes) and into a reused buffer otherwise.
+//
+// Every callback returns whether to go on; returning false stops parse().
+class QVariantHandler
+{
+public:
+    virtual ~QVariantHandler() = default;
+
+    virtual bool startObject() { return true; }
+    virtual bool key(QAnyStringView key) { Q_UNUSED(key); return true; }
+    virtual bool endObject() { return true; }
+
+    virtual bool startArray() { return true; }
+    virtual bool endArray() { return true; }
+
+    virtual bool string(QAnyStringView string) { Q_UNUSED(string); return true; }
+    virtual bool number(qint64 number) { Q_UNUSED(number); return true; }
+    virtual bool number(double number) { Q_UNUSED(number); return true; }
+    virtual bool boolean(bool value) { Q_UNUSED(value); return true; }
+    virtual bool null() { return true; }
+
+    // Any other value, such as a CBOR byte array, tag or undefined.
+    virtual bool value(const QVariant &value) { Q_UNUSED(value); return true; }
+};
+
+#endif // QVARIANTHANDLER_H
@@ -0,0 +1,15 @@
+#ifndef QVARIANTPAIRLIST_H
+#define QVARIANTPAIRLIST_H
+
+#include <QVariant>
+#include <QString>
+#include <QList>
+#include <QPair>
+
+// Flat, insertion-ordered object representation: cheaper to build than a
+// QVariantMap and keeps the source key order (and duplicate keys).
+typedef QList<QPair<QString, QVariant>> QVariantPairList;
+
+Q_DECLARE_METATYPE(QVariantPairList)
+
+#endif // QVARIANTPAIRLIST_H
@@ -1,4 +1,219 @@
 #include "qvariantreader.h"
+#include "qvarianthandler.h"
+#include <QStringList>
+#include <QFileDevice>
+#include <QMetaProperty>
+#include <QReadWriteLock>
+
+#if defined(Q_OS_UNIX)
+#  include <sys/mman.h>
+#  include <unistd.h>
+#endif
+
+namespace {
+
+// Writable properties by name, built once per type and shared by all
+// readers.
+typedef QHash<QString, QMetaProperty> PropertyTable;
+
+struct PropertyCache
+{
+    QReadWriteLock lock;
+    QHash<const QMetaObject *, PropertyTable> tables;
+};
+Q_GLOBAL_STATIC(PropertyCache, g_propertyCache)
+
+PropertyTable propertyTable(const QMetaObject *metaObject)
+{
+    PropertyCache *cache = g_propertyCache();
+    {
+        QReadLocker locker(&cache->lock);
+        const auto it = cache->tables.constFind(metaObject);
+        if (it != cache->tables.constEnd())
+            return it.value();
+    }
+
+    PropertyTable table;
+    for (int i = 0; i < metaObject->propertyCount(); ++i) {
+        const QMetaProperty property = metaObject->property(i);
+        if (property.isWritable())
+            table.insert(QString::fromLatin1(property.name()), property);
+    }
+
+    QWriteLocker locker(&cache->lock);
+    cache->tables.insert(metaObject, table);
+    return table;
+}
+
+// Trie of the requested JSON pointers (RFC 6901), one node per token.
+struct PointerNode
+{
+    QList<int> targets;                 // pointers ending at this node
+    QHash<QString, int> children;       // member name -> node
+    QStringList names;                  // member names, for matchKeys()
+    QHash<qsizetype, int> indexes;      // array index -> node
+};
+
+bool parsePointer(const QString &pointer, QStringList *tokens)
+{
+    if (pointer.isEmpty())
+        return true;
+    if (!pointer.startsWith(u'/'))
+        return false;
+    const QStringList parts = pointer.mid(1).split(u'/');
+    for (QString part : parts) {
+        part.replace(QLatin1String("~1"), QLatin1String("/"));
+        part.replace(QLatin1String("~0"), QLatin1String("~"));
+        tokens->append(part);
+    }
+    return true;
+}
+
+qsizetype arrayIndex(const QString &token)
+{
+    // array indexes are "0" or digits without a leading zero
+    if (token.isEmpty() || (token.size() > 1 && token.at(0) == u'0'))
+        return -1;
+    bool ok = false;
+    const qsizetype index = token.toLongLong(&ok);
+    return ok && index >= 0 && token.at(0).isDigit() ? index : -1;
+}
+
+bool childValue(const QVariant &value, const QString &token, QVariant *child)
+{
+    if (value.metaType() == QMetaType::fromType<QVariantPairList>()) {
+        for (const auto &pair : value.value<QVariantPairList>()) {
+            if (pair.first == token) {
+                *child = pair.second;
+                return true;
+            }
+        }
+        return false;
+    }
+    switch (value.metaType().id()) {
+    case QMetaType::QVariantMap: {
+        const QVariantMap map = value.toMap();
+        const auto it = map.constFind(token);
+        if (it == map.constEnd())
+            return false;
+        *child = it.value();
+        return true;
+    }
+    case QMetaType::QVariantHash: {
+        const QVariantHash hash = value.toHash();
+        const auto it = hash.constFind(token);
+        if (it == hash.constEnd())
+            return false;
+        *child = it.value();
+        return true;
+    }
+    case QMetaType::QVariantList: {
+        const QVariantList list = value.toList();
+        const qsizetype index = arrayIndex(token);
+        if (index < 0 || index >= list.size())
+            return false;
+        *child = list.at(index);
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+// The values found so far, and how many pointers are still unresolved.
+struct Extraction
+{
+    QVariantList results;
+    QList<bool> resolved;
+    int remaining;
+};
+
+// Resolves the pointers below an already materialized value. A duplicate
+// key reaches the same node again: its value replaces the earlier one, as
+// with fromJson(), but the pointer is only counted once.
+void resolve(const QVariant &value, const QList<PointerNode> &nodes, int index, Extraction &extraction)
+{
+    const PointerNode &node = nodes.at(index);
+    for (int target : node.targets) {
+        extraction.results[target] = value;
+        if (!extraction.resolved.at(target)) {
+            extraction.resolved[target] = true;
+            --extraction.remaining;
+        }
+    }
+    for (auto it = node.children.begin(); it != node.children.end(); ++it) {
+        QVariant child;
+        if (childValue(value, it.key(), &child))
+            resolve(child, nodes, it.value(), extraction);
+    }
+    for (auto it = node.indexes.begin(); it != node.indexes.end(); ++it) {
+        QVariant child;
+        if (childValue(value, QString::number(it.key()), &child))
+            resolve(child, nodes, it.value(), extraction);
+    }
+}
+
+// Walks the document along the trie, skipping every branch not requested.
+// Returns false on error, or once every pointer has been found.
+bool extractNode(QVariantReader &reader, int index, const QList<PointerNode> &nodes, Extraction &extraction)
+{
+    const PointerNode &node = nodes.at(index);
+
+    // a requested value is materialized, anything requested below it is
+    // then looked up in memory
+    if (!node.targets.isEmpty()) {
+        const QVariant value = reader.read();
+        if (reader.hasError())
+            return false;
+        resolve(value, nodes, index, extraction);
+        return extraction.remaining > 0;
+    }
+
+    if (reader.isMap()) {
+        reader.enterContainer();
+        while (!reader.hasError() && reader.hasNext()) {
+            // the member names are compared in place, only the requested
+            // ones are looked up
+            const qsizetype match = reader.matchKeys(node.names);
+            if (reader.hasError())
+                return false;
+            const int child = match >= 0 ? node.children.value(node.names.at(match)) : -1;
+            if (child >= 0) {
+                if (!extractNode(reader, child, nodes, extraction))
+                    return false;
+            } else if (!reader.skipValue()) {
+                return false;
+            }
+        }
+    } else if (reader.isList()) {
+        reader.enterContainer();
+        qsizetype i = 0;
+        while (!reader.hasError() && reader.hasNext()) {
+            const int child = node.indexes.value(i++, -1);
+            if (child >= 0) {
+                if (!extractNode(reader, child, nodes, extraction))
+                    return false;
+            } else if (!reader.skipValue()) {
+                return false;
+            }
+        }
+    } else {
+        return reader.skipValue();
+    }
+
+    if (reader.hasError())
+        return false;
+    reader.leaveContainer();
+    return !reader.hasError();
+}
+
+} // namespace
+
+QVariantReader::~QVariantReader()
+{
+    if (m_mappedFile && m_mappedData)
+        m_mappedFile->unmap(m_mappedData);
+}
 
 QVariant QVariantReader::read()
 {
@@ -6,12 +221,50 @@ QVariant QVariantReader::read()
     case QVariantReader::List:
         return readList();
     case QVariantReader::Map:
-        return readMap();
+        switch (m_mapType) {
+        case QVariantReader::VariantHash:
+            return readHash();
+        case QVariantReader::VariantPairList:
+            return QVariant::fromValue(readPairList());
+        default:
+            return readMap();
+        }
     default:
         return readValue();
         break;
     }
 }
+bool QVariantReader::parse(QVariantHandler *handler)
+{
+    switch (type()) {
+    case QVariantReader::List:
+        if (!handler->startArray())
+            return false;
+        enterContainer();
+        while (!hasError() && hasNext()) {
+            if (!parse(handler))
+                return false;
+        }
+        if (hasError())
+            return false;
+        leaveContainer();
+        return !hasError() && handler->endArray();
+    case QVariantReader::Map:
+        if (!handler->startObject())
+            return false;
+        enterContainer();
+        while (!hasError() && hasNext()) {
+            if (!parseKey(handler) || !parse(handler))
+                return false;
+        }
+        if (hasError())
+            return false;
+        leaveContainer();
+        return !hasError() && handler->endObject();
+    default:
+        return parseValue(handler);
+    }
+}
 QVariantList QVariantReader::readList()
 {
     QVariantList list;
@@ -31,13 +284,11 @@ QVariantList QVariantReader::readList()
 }
 QVariantMap QVariantReader::readMap()
 {
-    QVariantMap map;
-    // if (m_device->isLengthKnown())
-    //     map.reserve(m_device->length());
+    QVariantMap map; // QMap cannot reserve, see readHash() and readPairList()
 
     enterContainer();
     while (!hasError() && hasNext()) {
-        QString key = read().toString();
+        QString key = readKey();
         map.insert(std::move(key), read());
     }
     if (!hasError())
@@ -45,3 +296,248 @@ QVariantMap QVariantReader::readMap()
 
     return map;
 }
+QVariantHash QVariantReader::readHash()
+{
+    QVariantHash hash;
+    if (isLengthKnown())
+        hash.reserve(length());
+
+    enterContainer();
+    while (!hasError() && hasNext()) {
+        QString key = readKey();
+        hash.insert(std::move(key), read());
+    }
+    if (!hasError())
+        leaveContainer();
+
+    return hash;
+}
+QVariantPairList QVariantReader::readPairList()
+{
+    QVariantPairList list;
+    if (isLengthKnown())
+        list.reserve(length());
+
+    enterContainer();
+    while (!hasError() && hasNext()) {
+        QString key = readKey();
+        list.append(qMakePair(std::move(key), read()));
+    }
+    if (!hasError())
+        leaveContainer();
+
+    list.squeeze();
+
+    return list;
+}
+bool QVariantReader::readGadget(void *gadget, const QMetaObject *metaObject)
+{
+    return readProperties(gadget, metaObject, true);
+}
+
+bool QVariantReader::readObject(QObject *object)
+{
+    return readProperties(object, object->metaObject(), false);
+}
+
+bool QVariantReader::readProperties(void *object, const QMetaObject *metaObject, bool isGadget)
+{
+    if (!isMap()) {
+        skipValue();
+        return false;
+    }
+
+    const PropertyTable properties = propertyTable(metaObject);
+
+    enterContainer();
+    while (!hasError() && hasNext()) {
+        const QString key = readKey();
+        if (hasError())
+            break;
+        const auto it = properties.constFind(key);
+        if (it == properties.constEnd()) {
+            skipValue();
+            continue;
+        }
+
+        const QMetaProperty &property = it.value();
+        const QMetaType type = property.metaType();
+        QVariant value;
+        if ((type.flags() & QMetaType::IsGadget) && isMap()) {
+            // nested gadgets are filled in place as well
+            value = QVariant(type);
+            readProperties(value.data(), type.metaObject(), true);
+        } else {
+            value = read();
+        }
+        if (hasError())
+            break;
+
+        if (isGadget)
+            property.writeOnGadget(object, value);
+        else
+            property.write(static_cast<QObject *>(object), value);
+    }
+    if (!hasError())
+        leaveContainer();
+
+    return !hasError();
+}
+
+bool QVariantReader::parseKey(QVariantHandler *handler)
+{
+    const QString key = readKey();
+    return !hasError() && handler->key(key);
+}
+
+bool QVariantReader::parseValue(QVariantHandler *handler)
+{
+    // scalars are stored inline in a QVariant, so going through one
+    // allocates nothing but strings, which readers override
+    const QVariant value = readValue();
+    if (hasError())
+        return false;
+
+    switch (value.metaType().id()) {
+    case QMetaType::Nullptr:
+        return handler->null();
+    case QMetaType::Bool:
+        return handler->boolean(value.toBool());
+    case QMetaType::Int:
+    case QMetaType::LongLong:
+        return handler->number(qint64(value.toLongLong()));
+    case QMetaType::Float:
+    case QMetaType::Double:
+        return handler->number(value.toDouble());
+    case QMetaType::QString:
+        return handler->string(value.toString());
+    default:
+        return handler->value(value);
+    }
+}
+
+QVariantList QVariantReader::extract(const QStringList &pointers)
+{
+    Extraction extraction{QVariantList(pointers.size()), QList<bool>(pointers.size(), false), 0};
+    QList<PointerNode> nodes(1);
+
+    for (int i = 0; i < pointers.size(); ++i) {
+        QStringList tokens;
+        if (!parsePointer(pointers.at(i), &tokens))
+            continue;
+        int node = 0;
+        for (const QString &token : tokens) {
+            int child = nodes.at(node).children.value(token, -1);
+            if (child < 0) {
+                child = nodes.size();
+                nodes.append(PointerNode());
+                nodes[node].children.insert(token, child);
+                nodes[node].names.append(token);
+                const qsizetype index = arrayIndex(token);
+                if (index >= 0)
+                    nodes[node].indexes.insert(index, child);
+            }
+            node = child;
+        }
+        nodes[node].targets.append(i);
+        ++extraction.remaining;
+    }
+
+    if (extraction.remaining > 0)
+        extractNode(*this, 0, nodes, extraction);
+
+    return extraction.results;
+}
+QString QVariantReader::readKey()
+{
+    return read().toString();
+}
+
+bool QVariantReader::findKey(QStringView key)
+{
+    while (!hasError() && hasNext()) {
+        if (matchKey(key))
+            return !hasError();
+        if (hasError() || !skipValue())
+            break;
+    }
+    return false;
+}
+bool QVariantReader::matchKey(QStringView key)
+{
+    return readKey() == key;
+}
+qsizetype QVariantReader::matchKeys(const QStringList &keys)
+{
+    // the key goes through parseKey(), which hands over the raw UTF-8 when
+    // the reader has it
+    struct KeyMatcher : public QVariantHandler
+    {
+        explicit KeyMatcher(const QStringList &keys): keys(keys) {}
+        bool key(QAnyStringView key) override
+        {
+            for (qsizetype i = 0; i < keys.size(); ++i) {
+                if (QAnyStringView::equal(key, keys.at(i))) {
+                    index = i;
+                    break;
+                }
+            }
+            return true;
+        }
+
+        const QStringList &keys;
+        qsizetype index = -1;
+    };
+
+    KeyMatcher matcher(keys);
+    parseKey(&matcher);
+    return hasError() ? -1 : matcher.index;
+}
+
+QByteArray QVariantReader::mapFile(QIODevice *device)
+{
+    QFileDevice *file = qobject_cast<QFileDevice *>(device);
+    if (!file || file->isSequential() || !file->isReadable())
+        return QByteArray();
+
+    const qint64 offset = file->pos();
+    const qint64 size = file->size() - offset;
+    if (size <= 0)
+        return QByteArray();
+
+    uchar *data = file->map(offset, size);
+    if (!data)
+        return QByteArray();
+
+#if defined(Q_OS_UNIX) && defined(MADV_SEQUENTIAL)
+    // the readers go front to back: let the kernel read ahead aggressively
+    const quintptr pageMask = quintptr(::sysconf(_SC_PAGESIZE)) - 1;
+    const quintptr begin = quintptr(data) & ~pageMask;
+    ::madvise(reinterpret_cast<void *>(begin), size + (quintptr(data) - begin), MADV_SEQUENTIAL);
+#endif
+
+    // leave the device where reading it all would have left it
+    file->seek(offset + size);
+
+    m_mappedFile = file;
+    m_mappedData = data;
+    return QByteArray::fromRawData(reinterpret_cast<const char *>(data), size);
+}
+
+bool QVariantReader::isInternable(bool isKey, qsizetype size) const
+{
+    if (size <= 0)
+        return false;
+    if (isKey)
+        return m_options.testFlag(InternKeys);
+    return m_options.testFlag(InternStrings) && size <= m_internStringLimit;
+}
+QString QVariantReader::internedString(const char *data, qsizetype size) const
+{
+    return m_internedStrings.value(QByteArray::fromRawData(data, size));
+}
+void QVariantReader::internString(const char *data, qsizetype size, const QString &string)
+{
+    if (m_internedStrings.size() < MaxInternedStrings)
+        m_internedStrings.insert(QByteArray(data, size), string);
+}
@@ -4,7 +4,15 @@
 #include <QVariant>
 #include <QByteArray>
 #include <QIODevice>
+#include <QHash>
+#include <QPointer>
+#include <QObject>
+#include <QMetaObject>
 
+#include "qvariantpairlist.h"
+
+class QFileDevice;
+class QVariantHandler;
 class QVariantReader
 {
 public:
@@ -15,8 +23,30 @@ public:
         Invalid = 3
     };
 
+    enum ReadOption {
+        NoOptions = 0x0,
+        InternKeys = 0x1,
+        InternStrings = 0x2
+    };
+    Q_DECLARE_FLAGS(ReadOptions, ReadOption)
+
+    enum MapType : quint8 {
+        VariantMap = 0,
+        VariantHash = 1,
+        VariantPairList = 2
+    };
+
     QVariantReader() = default;
-    virtual ~QVariantReader() = default;
+    virtual ~QVariantReader();
+
+    ReadOptions readOptions() const { return m_options; }
+    void setReadOptions(ReadOptions options) { m_options = options; }
+
+    int internStringLimit() const { return m_internStringLimit; }
+    void setInternStringLimit(int length) { m_internStringLimit = length; }
+
+    MapType mapType() const { return m_mapType; }
+    void setMapType(MapType type) { m_mapType = type; }
 
     int currentProgress() const { return (currentOffset()/(double)totalSize()) * 10000.0; }
     virtual qint64 currentOffset() const = 0;
@@ -41,13 +71,79 @@ public:
     virtual bool enterContainer() = 0;
     virtual bool leaveContainer() = 0;
 
+    virtual bool skipValue() = 0;
+    bool findKey(QStringView key);
+    // Reads the current key and returns the index of the first of keys it
+    // equals, or -1. The key is compared as it is read, never decoded into a
+    // QString.
+    qsizetype matchKeys(const QStringList &keys);
+
     QVariant read();
     QVariantList readList();
     QVariantMap readMap();
+    QVariantHash readHash();
+    QVariantPairList readPairList();
+    virtual QString readKey();
     virtual QVariant readValue() = 0;
 
+    bool parse(QVariantHandler *handler);
+
+    // Fills the properties of a Q_GADGET or QObject from the current map;
+    // keys without a matching writable property are skipped.
+    template<typename T>
+    bool readInto(T *value)
+    {
+        if constexpr (std::is_base_of_v<QObject, T>)
+            return readObject(value);
+        else
+            return readGadget(value, &T::staticMetaObject);
+    }
+    template<typename T>
+    T readInto()
+    {
+        T value{};
+        readInto(&value);
+        return value;
+    }
+    bool readGadget(void *gadget, const QMetaObject *metaObject);
+    bool readObject(QObject *object);
+
+    QVariantList extract(const QStringList &pointers);
+
     virtual int errorCode() = 0;
     virtual QString errorString() = 0;
+
+protected:
+    virtual bool matchKey(QStringView key);
+
+    // Hand the current key or value to a handler, see parse().
+    virtual bool parseKey(QVariantHandler *handler);
+    virtual bool parseValue(QVariantHandler *handler);
+
+    // Maps the rest of a QFile (or other QFileDevice) into memory, or
+    // returns a null QByteArray if the device cannot be mapped.
+    QByteArray mapFile(QIODevice *device);
+
+    // String interning, keyed by the encoded bytes of the string so a hit
+    // costs neither decoding nor allocation.
+    bool isInternable(bool isKey, qsizetype size) const;
+    QString internedString(const char *data, qsizetype size) const;
+    void internString(const char *data, qsizetype size, const QString &string);
+
+private:
+    bool readProperties(void *object, const QMetaObject *metaObject, bool isGadget);
+
+    enum { MaxInternedStrings = 16384 };
+
+    ReadOptions m_options = NoOptions;
+    MapType m_mapType = VariantMap;
+    int m_internStringLimit = 32;
+    QHash<QByteArray, QString> m_internedStrings;
+
+    QPointer<QFileDevice> m_mappedFile;
+    uchar *m_mappedData = nullptr;
 };
 
+Q_DECLARE_OPERATORS_FOR_FLAGS(QVariantReader::ReadOptions)
+
 #endif // QVARIANTREADER_H
@@ -1,7 +1,11 @@
 #include <QtTest>
+#include <QCborMap>
 
 #include "qcborvariantwriter.h"
 #include "qcborvariantreader.h"
+#include "qvarianthandler.h"
+
+#include "testdata.h"
 
 class TestCbor : public QObject
 {
@@ -16,10 +20,30 @@ private slots:
 
     void writing_data();
     void writing();
+    void serializedSize_data();
+    void serializedSize();
+    void parallelWriting_data();
+    void parallelWriting();
 
     void parsing_data();
     void parsing();
 
+    void interning();
+
+    void mappedParser();
+
+    void findKey();
+    void findKeyAfterTag();
+    void handler();
+    void gadgets();
+
+    void validate_data();
+    void validate();
+    void extract();
+
+    void mapTypes_data();
+    void mapTypes();
+
 private:
     QVariant m_testVariant;
 };
@@ -82,6 +106,77 @@ void TestCbor::writing()
     QCOMPARE(result, expected);
 }
 
+void TestCbor::serializedSize_data()
+{
+    QTest::addColumn<QVariant>("variant");
+    QTest::addColumn<int>("options");
+
+    QVariantList numbers{0, -1, 23, 24, -24, -25, 255, 256, 65535, 65536, -65537, 4294967295ll, 4294967296ll,
+                         std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(),
+                         std::numeric_limits<quint64>::max(), 1.5, 0.1, -0.0, 65504.0, 1e300, 3.0,
+                         qQNaN(), qInf(), 1.0f / 3, QVariant::fromValue<short>(-7)};
+    QVariantList strings{QString(), QString(23, u'a'), QString(24, u'a'), QString(300, u'\u00e9'),
+                         QString(u"\u263A \U0001F60A"), QString(1, QChar(0xd800)) + QString(u"x"),
+                         QByteArray(), QByteArray(70000, 'b')};
+    TestData::Person person;
+    person.name = "Ada";
+    person.tags = QStringList{"a", "b"};
+    QVariantHash hash;
+    hash.insert("numbers", numbers);
+    hash.insert(QString(u"k\u00e9y"), QVariant::fromValue(person));
+    QVariantPairList pairs;
+    pairs.append({"strings", strings});
+    pairs.append({"hash", hash});
+    const QVariant all = QVariant::fromValue(pairs);
+
+    QTest::newRow("test variant default") << m_testVariant << 0;
+    QTest::newRow("test variant float16") << m_testVariant << (int)QCborValue::UseFloat16;
+    QTest::newRow("all default") << all << 0;
+    QTest::newRow("all float16") << all << (int)QCborValue::UseFloat16;
+    QTest::newRow("all integers") << all << (int)(QCborValue::UseFloat | QCborValue::UseIntegers);
+}
+
+void TestCbor::serializedSize()
+{
+    QFETCH(QVariant, variant);
+    QFETCH(int, options);
+
+    const QByteArray cbor = QCborVariantWriter::fromVariant(variant, options);
+    QCOMPARE(QCborVariantWriter::serializedSize(variant, options), cbor.size());
+    QCOMPARE(QCborVariantWriter::fromVariant(variant, options, true), cbor);
+}
+
+void TestCbor::parallelWriting_data()
+{
+    QTest::addColumn<QVariant>("variant");
+    QTest::addColumn<int>("options");
+
+    const QList<QPair<QString, QVariant>> rows = TestData::parallelWritingRows(m_testVariant);
+    for (int options : {0, (int)QCborValue::UseFloat16}) {
+        const QString suffix = options ? " float16" : " default";
+        for (const auto &row : rows)
+            QTest::newRow(qPrintable(row.first + suffix)) << row.second << options;
+    }
+}
+
+void TestCbor::parallelWriting()
+{
+    QFETCH(QVariant, variant);
+    QFETCH(int, options);
+
+    // fewer threads than the five slices of the large containers, so
+    // slices also wait for a thread or run on the calling one
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+
+    const QByteArray expected = QCborVariantWriter::fromVariant(variant, options);
+    QCOMPARE(QCborVariantWriter::fromVariantParallel(variant, options, &pool), expected);
+
+    QBuffer buffer;
+    QCborVariantWriter::fromVariantParallel(variant, &buffer, options, &pool);
+    QCOMPARE(buffer.data(), expected);
+}
+
 void TestCbor::parsing_data()
 {
     QTest::addColumn<QVariant>("variant");
@@ -104,6 +199,204 @@ void TestCbor::parsing()
     QCOMPARE(result, expected);
 }
 
+void TestCbor::mapTypes_data()
+{
+    QTest::addColumn<QVariant>("variant");
+    QTest::addColumn<int>("mapType");
+
+    QTest::newRow("hash") << m_testVariant << int(QVariantReader::VariantHash);
+    QTest::newRow("pair list") << m_testVariant << int(QVariantReader::VariantPairList);
+}
+
+void TestCbor::mapTypes()
+{
+    QFETCH(QVariant, variant);
+    QFETCH(int, mapType);
+
+    QByteArray cbor = QCborValue::fromVariant(variant).toCbor();
+
+    QCborVariantReader reader(cbor);
+    reader.setMapType(QVariantReader::MapType(mapType));
+    QVariant result = reader.read();
+
+    QCOMPARE(TestData::normalized(result), QCborValue::fromCbor(cbor).toVariant());
+    if (mapType == QVariantReader::VariantPairList)
+        QCOMPARE(QCborVariantWriter::fromVariant(result), cbor);
+}
+
+void TestCbor::findKey()
+{
+    const QByteArray cbor = QCborValue::fromVariant(m_testVariant).toCbor();
+    const QVariantMap expected = QCborValue::fromCbor(cbor).toVariant().toMap();
+
+    QCborVariantReader reader(cbor);
+    QVERIFY(reader.enterContainer());
+    QVERIFY(reader.findKey(u"object"));
+    QCOMPARE(reader.read(), expected.value("object"));
+    QVERIFY(reader.findKey(u"ztring"));
+    QCOMPARE(reader.read(), expected.value("ztring"));
+    QVERIFY(!reader.findKey(u"array"));
+    QVERIFY(reader.leaveContainer());
+    QVERIFY(!reader.hasError());
+}
+
+void TestCbor::findKeyAfterTag()
+{
+    // the tag and the value it applies to are skipped together
+    const QCborMap map{{QStringLiteral("tagged"), QCborValue(QCborTag(1), 1700000000)},
+                       {QStringLiteral("value"), 42}};
+    const QByteArray cbor = map.toCborValue().toCbor();
+
+    QCborVariantReader reader(cbor);
+    QVERIFY(reader.enterContainer());
+    QVERIFY(reader.findKey(u"value"));
+    QCOMPARE(reader.read(), QVariant(42));
+    QVERIFY(reader.leaveContainer());
+    QVERIFY(!reader.hasError());
+
+    QCborParserError error;
+    const QVariantList result = QCborVariantReader::extract(cbor, {"/value"}, &error);
+    QVERIFY(error.error == QCborError::NoError);
+    QCOMPARE(result, QVariantList{42});
+}
+
+void TestCbor::handler()
+{
+    const QByteArray cbor = QCborValue::fromVariant(m_testVariant).toCbor();
+
+    QCborVariantReader reader(cbor);
+    TestData::VariantBuilder builder;
+    QVERIFY(reader.parse(&builder));
+    QVERIFY(!reader.hasError());
+    QCOMPARE(builder.result, QCborVariantReader::fromCbor(cbor));
+
+    // CBOR text is UTF-8, every key and string is handed over as such
+    QVERIFY(builder.utf8Views > 0);
+    QCOMPARE(builder.utf16Views, 0);
+}
+
+void TestCbor::gadgets()
+{
+    TestData::Person person;
+    person.name = "Ada";
+    person.height = 1.75;
+    person.active = true;
+    person.tags = QStringList{"a", "b"};
+    person.address.street = "Main";
+    person.address.number = 5;
+
+    QByteArray cbor;
+    {
+        QCborVariantWriter writer(&cbor);
+        writer.writeGadget(person);
+    }
+    QCOMPARE(QCborVariantWriter::fromVariant(QVariant::fromValue(person)), cbor);
+
+    QCborVariantReader reader(cbor);
+    const TestData::Person result = reader.readInto<TestData::Person>();
+    QVERIFY(!reader.hasError());
+    QCOMPARE(result.name, person.name);
+    QCOMPARE(result.height, person.height);
+    QCOMPARE(result.active, person.active);
+    QCOMPARE(result.tags, person.tags);
+    QCOMPARE(result.address.street, person.address.street);
+    QCOMPARE(result.address.number, person.address.number);
+}
+
+void TestCbor::validate_data()
+{
+    QTest::addColumn<QByteArray>("cbor");
+
+    const QByteArray cbor = QCborValue::fromVariant(m_testVariant).toCbor();
+    QTest::newRow("valid") << cbor;
+    QTest::newRow("truncated") << cbor.left(cbor.size() / 2);
+    QTest::newRow("invalid utf-8") << QByteArray("\x82\x01\x62\xff\xfe");
+    QTest::newRow("tagged") << QCborValue(QCborTag(1), 1700000000).toCbor();
+    QTest::newRow("empty") << QByteArray();
+}
+
+void TestCbor::validate()
+{
+    QFETCH(QByteArray, cbor);
+
+    QCborParserError expectedError;
+    QCborVariantReader::fromCbor(cbor, &expectedError);
+
+    QCborParserError error;
+    QCOMPARE(QCborVariantReader::validate(cbor, &error), expectedError.error == QCborError::NoError);
+    QVERIFY(error.error == expectedError.error);
+    QCOMPARE(error.offset, expectedError.offset);
+}
+
+void TestCbor::extract()
+{
+    const QByteArray cbor = QCborValue::fromVariant(m_testVariant).toCbor();
+    const QVariantMap expected = QCborValue::fromCbor(cbor).toVariant().toMap();
+
+    QCborParserError error;
+    const QVariantList result = QCborVariantReader::extract(cbor, {"/object/list/1", "/point", "/array/4", "/missing", "/point/x"}, &error);
+
+    QVERIFY(error.error == QCborError::NoError);
+    QCOMPARE(result.size(), 5);
+    QCOMPARE(result.at(0), QVariant("b"));
+    QCOMPARE(result.at(1), expected.value("point"));
+    QCOMPARE(result.at(2), QVariant(3.5));
+    QVERIFY(!result.at(3).isValid());
+    QCOMPARE(result.at(4), expected.value("point").toMap().value("x"));
+}
+
+void TestCbor::mappedParser()
+{
+    const QByteArray cbor = QCborValue::fromVariant(m_testVariant).toCbor();
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(cbor);
+    file.seek(0);
+
+    QCborParserError error;
+    QVariant result = QCborVariantReader::fromCbor(&file, &error);
+
+    QVERIFY(error.error == QCborError::NoError);
+    QCOMPARE(result, QCborVariantReader::fromCbor(cbor));
+    QVERIFY(file.atEnd());
+}
+
+void TestCbor::interning()
+{
+    QVariantList records;
+    for (int i = 0; i < 2; ++i)
+        records.append(QVariantMap{{"id", i}, {"state", "on"}, {"text", "a long value that should not be interned"}});
+    const QByteArray cbor = QCborValue::fromVariant(records).toCbor();
+
+    QCborVariantReader reader(cbor);
+    reader.setReadOptions(QVariantReader::InternKeys | QVariantReader::InternStrings);
+    reader.setInternStringLimit(8);
+    const QVariantList result = reader.read().toList();
+
+    QCOMPARE(QVariant(result), QCborValue::fromCbor(cbor).toVariant());
+
+    const QVariantMap first = result.at(0).toMap();
+    const QVariantMap second = result.at(1).toMap();
+    QCOMPARE(first.firstKey().constData(), second.firstKey().constData());
+    QCOMPARE(first.value("state").toString().constData(), second.value("state").toString().constData());
+    QVERIFY(first.value("text").toString().constData() != second.value("text").toString().constData());
+
+    // chunked strings are held to the same limit once gathered
+    const QByteArray longString = QByteArray("\x7f\x6f" "a long chunked " "\x65" "value" "\xff", 24);
+    const QByteArray shortString = QByteArray("\x7f\x61" "o" "\x61" "n" "\xff", 6);
+    const QByteArray chunked = "\x84" + longString + longString + shortString + shortString;
+
+    QCborVariantReader chunkedReader(chunked);
+    chunkedReader.setReadOptions(QVariantReader::InternStrings);
+    chunkedReader.setInternStringLimit(8);
+    const QVariantList strings = chunkedReader.read().toList();
+
+    QCOMPARE(QVariant(strings), QCborValue::fromCbor(chunked).toVariant());
+    QVERIFY(strings.at(0).toString().constData() != strings.at(1).toString().constData());
+    QCOMPARE(strings.at(2).toString().constData(), strings.at(3).toString().constData());
+}
+
 QTEST_APPLESS_MAIN(TestCbor)
 
 #include "tst_cbor.moc"
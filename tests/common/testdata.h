@@ -0,0 +1,162 @@
+#ifndef TESTDATA_H
+#define TESTDATA_H
+
+#include <QObject>
+#include <QVariant>
+#include <QStringList>
+#include <QList>
+#include <QPair>
+#include <QStack>
+#include <QAnyStringView>
+
+#include "qvariantpairlist.h"
+#include "qvarianthandler.h"
+
+// Fixtures and helpers shared by the JSON and CBOR tests.
+namespace TestData {
+
+// Gadgets for the readInto() and writeGadget() tests. This header is listed
+// in the test sources so that moc runs on it.
+struct Address
+{
+    Q_GADGET
+    Q_PROPERTY(QString street MEMBER street)
+    Q_PROPERTY(int number MEMBER number)
+public:
+    QString street;
+    int number = 0;
+};
+
+struct Person
+{
+    Q_GADGET
+    Q_PROPERTY(QString name MEMBER name)
+    Q_PROPERTY(double height MEMBER height)
+    Q_PROPERTY(bool active MEMBER active)
+    Q_PROPERTY(QStringList tags MEMBER tags)
+    Q_PROPERTY(TestData::Address address MEMBER address)
+public:
+    QString name;
+    double height = 0;
+    bool active = false;
+    QStringList tags;
+    Address address;
+};
+
+// The value with every QVariantHash and QVariantPairList turned into a
+// QVariantMap, recursively, to compare with QJsonDocument and QCborValue
+// results.
+inline QVariant normalized(const QVariant &variant)
+{
+    if (variant.metaType() == QMetaType::fromType<QVariantPairList>()) {
+        QVariantMap map;
+        for (const auto &pair : variant.value<QVariantPairList>())
+            map.insert(pair.first, normalized(pair.second));
+        return map;
+    }
+    switch (variant.metaType().id()) {
+    case QMetaType::QVariantHash: {
+        QVariantMap map;
+        const QVariantHash hash = variant.toHash();
+        for (auto it = hash.begin(); it != hash.end(); ++it)
+            map.insert(it.key(), normalized(it.value()));
+        return map;
+    }
+    case QMetaType::QVariantMap: {
+        QVariantMap map = variant.toMap();
+        for (auto it = map.begin(); it != map.end(); ++it)
+            it.value() = normalized(it.value());
+        return map;
+    }
+    case QMetaType::QVariantList: {
+        QVariantList list = variant.toList();
+        for (QVariant &item : list)
+            item = normalized(item);
+        return list;
+    }
+    default:
+        return variant;
+    }
+}
+
+
+// Rows for the parallel writer tests: containers of 5000 members, split in
+// five slices of QParallelWriter::MinimumSliceSize, of each kind the
+// writers split, plus a small list that is not split and large containers
+// nested below small ones.
+inline QList<QPair<QString, QVariant>> parallelWritingRows(const QVariant &testVariant)
+{
+    QVariantList list;
+    QStringList strings;
+    QVariantMap map;
+    QVariantHash hash;
+    QVariantPairList pairs;
+    for (int i = 0; i < 5000; ++i) {
+        list.append(i % 3 ? testVariant : QVariant(QVariantList{i, QString::number(i)}));
+        strings.append(QString("string \"%1\"").arg(i));
+        map.insert(QString::number(i), i % 2 ? QVariant(i * 0.5) : testVariant);
+        hash.insert(QString::number(i), QVariantList{i});
+        pairs.append({QString::number(i % 100), i});
+    }
+
+    return {
+        {"small list", QVariant(QVariantList{1, "two", testVariant})},
+        {"list", QVariant(list)},
+        {"string list", QVariant(strings)},
+        {"map", QVariant(map)},
+        {"hash", QVariant(hash)},
+        {"pair list", QVariant::fromValue(pairs)},
+        {"nested", QVariant(QVariantMap{{"list", list}, {"small", QVariantList{1, 2}},
+                                        {"more", QVariantList{map, QVariantList(), strings}}})}
+    };
+}
+
+// Builds the value a handler is given back into a QVariant, counting the
+// keys and strings handed over as UTF-8 and as UTF-16 views.
+class VariantBuilder : public QVariantHandler
+{
+public:
+    bool startObject() override { m_stack.push({ QVariantList(), QVariantMap(), QString(), true }); return true; }
+    bool key(QAnyStringView key) override { count(key); m_stack.top().key = key.toString(); return true; }
+    bool endObject() override { add(m_stack.pop().map); return true; }
+
+    bool startArray() override { m_stack.push({ QVariantList(), QVariantMap(), QString(), false }); return true; }
+    bool endArray() override { add(m_stack.pop().list); return true; }
+
+    bool string(QAnyStringView string) override { count(string); add(string.toString()); return true; }
+    bool number(qint64 number) override { add(qlonglong(number)); return true; }
+    bool number(double number) override { add(number); return true; }
+    bool boolean(bool value) override { add(value); return true; }
+    bool null() override { add(QVariant::fromValue(nullptr)); return true; }
+    bool value(const QVariant &value) override { add(value); return true; }
+
+    QVariant result;
+    int utf8Views = 0;
+    int utf16Views = 0;
+
+private:
+    struct Container
+    {
+        QVariantList list;
+        QVariantMap map;
+        QString key;
+        bool isMap;
+    };
+
+    void count(QAnyStringView view) { view.isUtf8() ? ++utf8Views : ++utf16Views; }
+    void add(const QVariant &value)
+    {
+        if (m_stack.isEmpty())
+            result = value;
+        else if (m_stack.top().isMap)
+            m_stack.top().map.insert(m_stack.top().key, value);
+        else
+            m_stack.top().list.append(value);
+    }
+
+    QStack<Container> m_stack;
+};
+
+} // namespace TestData
+
+#endif // TESTDATA_H
@@ -2,9 +2,28 @@
 
 #include "qjsonvariantwriter.h"
 #include "qjsonvariantreader.h"
+#include "qjsonvariantpushparser.h"
+#include "qjsonvariantlinesreader.h"
+#include "qjsonformatter.h"
+#include "qjsoncbortranscoder.h"
+#include "qvarianthandler.h"
+#include "qjsonscanner.h"
 
 #include "qcborvariantwriter.h"
 #include "qcborvariantreader.h"
+
+#include "testdata.h"
+
+class Settings : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(int level MEMBER level)
+    Q_PROPERTY(QString mode MEMBER mode)
+public:
+    int level = 0;
+    QString mode;
+};
+
 class TestJson : public QObject
 {
     Q_OBJECT
@@ -25,11 +44,82 @@ private slots:
     void fileParser_data();
     void fileParser();
 
+    void chunkedParser_data();
+    void chunkedParser();
+
+    void mappedParser_data();
+    void mappedParser();
+
+    void pushParser_data();
+    void pushParser();
+    void pushParserSequence();
+    void pushParserErrors_data();
+    void pushParserErrors();
+
+    void structuralIndex_data();
+    void structuralIndex();
+
+    void parallelArray_data();
+    void parallelArray();
+
+    void jsonLines_data();
+    void jsonLines();
+    void jsonLinesError();
+
     void fileWriter_data();
     void fileWriter();
+    void concurrentWriting();
+    void parallelWriting_data();
+    void parallelWriting();
+
+    void numbers_data();
+    void numbers();
+    void numberFormatting();
+
+    void scannerKernels();
+
+    void strings_data();
+    void strings();
+    void stringWriting_data();
+    void stringWriting();
+    void serializedSize_data();
+    void serializedSize();
+
+    void interning();
+
+    void mapTypes_data();
+    void mapTypes();
+    void pairListRoundTrip();
+
+    void skipValue();
+    void findKey();
+
+    void handler_data();
+    void handler();
+    void handlerViews();
+
+    void gadgets();
+
+    void validate_data();
+    void validate();
+
+    void formatter_data();
+    void formatter();
+
+    void transcoder_data();
+    void transcoder();
+    void transcoderCbor();
+
+    void extract_data();
+    void extract();
+    void numberBenchmark();
+    void structuralIndexBenchmark();
+    void transcoderBenchmark();
 
     void benchmark_data();
     void benchmark();
+    void threadedWriting_data();
+    void threadedWriting();
 
 private:
     QVariant m_testVariant;
@@ -140,6 +230,309 @@ void TestJson::fileParser()
     QCOMPARE(result, expected);
 }
 
+void TestJson::chunkedParser_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow(":/test.json 16") << ":/test.json" << 16;
+    QTest::newRow(":/test.json 1024") << ":/test.json" << 1024;
+    QTest::newRow(":/test2.json 16") << ":/test2.json" << 16;
+    QTest::newRow(":/test3.json 16") << ":/test3.json" << 16;
+    QTest::newRow(":/test4.json 16") << ":/test4.json" << 16;
+}
+
+void TestJson::chunkedParser()
+{
+    QFETCH(QString, fileName);
+    QFETCH(int, chunkSize);
+
+    QFile file(fileName);
+    file.open(QFile::ReadOnly);
+    QByteArray json = file.readAll();
+
+    QJsonVariantReader expectedReader(json);
+    QVariant expected = expectedReader.read();
+
+    QBuffer buffer(&json);
+    buffer.open(QIODevice::ReadOnly);
+    QJsonVariantReader reader(&buffer, chunkSize);
+    QVariant result = reader.read();
+
+    QCOMPARE(result, expected);
+    QCOMPARE(reader.currentOffset(), expectedReader.currentOffset());
+    QCOMPARE(reader.totalSize(), expectedReader.totalSize());
+    QCOMPARE(reader.lastError(), QJsonParseError::NoError);
+}
+
+void TestJson::mappedParser_data()
+{
+    fileParser_data();
+}
+
+void TestJson::mappedParser()
+{
+    QFETCH(QString, fileName);
+
+    QFile resource(fileName);
+    resource.open(QFile::ReadOnly);
+    QByteArray json = resource.readAll();
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(json);
+    file.seek(0);
+
+    QJsonParseError error;
+    QVariant result = QJsonVariantReader::fromJson(&file, &error);
+
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QCOMPARE(result, QJsonVariantReader::fromJson(json));
+    QVERIFY(file.atEnd());
+}
+
+void TestJson::pushParser_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow(":/test.json 1") << ":/test.json" << 1;
+    QTest::newRow(":/test.json 7") << ":/test.json" << 7;
+    QTest::newRow(":/test2.json 1") << ":/test2.json" << 1;
+    QTest::newRow(":/test3.json 1") << ":/test3.json" << 1;
+    QTest::newRow(":/test4.json 1") << ":/test4.json" << 1;
+}
+
+void TestJson::pushParser()
+{
+    QFETCH(QString, fileName);
+    QFETCH(int, chunkSize);
+
+    QFile file(fileName);
+    file.open(QFile::ReadOnly);
+    QByteArray json = file.readAll();
+
+    QVariant expected = QJsonVariantReader::fromJson(json);
+
+    QJsonVariantPushParser parser;
+    for (qsizetype i = 0; i < json.size(); i += chunkSize)
+        parser.feed(json.mid(i, chunkSize));
+    QVERIFY(parser.finish());
+
+    QCOMPARE(parser.valueCount(), 1);
+    QCOMPARE(parser.takeValue(), expected);
+}
+
+void TestJson::pushParserSequence()
+{
+    const QByteArray json = R"(12 [1, "a]"] {"k": "\"}"} "s" true -3.5e2)";
+
+    QJsonVariantPushParser parser;
+    for (char c : json) {
+        parser.feed(QByteArray(1, c));
+        QVERIFY(!parser.hasError());
+    }
+    QCOMPARE(parser.valueCount(), 5);
+    QVERIFY(parser.finish());
+
+    QVariantList expected {
+        12ll,
+        QVariantList{1ll, "a]"},
+        QVariantMap{{"k", "\"}"}},
+        "s",
+        true,
+        -350.0
+    };
+    QCOMPARE(parser.takeValues(), expected);
+    QCOMPARE(parser.currentOffset(), qint64(json.size()));
+
+    parser.feed("[1, 2");
+    QVERIFY(!parser.finish());
+    QVERIFY(parser.hasError());
+
+    // a byte order mark split across feeds
+    parser.reset();
+    for (char c : QByteArray("\xef\xbb\xbf[1]"))
+        parser.feed(QByteArray(1, c));
+    QVERIFY(parser.finish());
+    QCOMPARE(parser.takeValue(), QVariant(QVariantList{1ll}));
+}
+
+void TestJson::pushParserErrors_data()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<int>("error");
+
+    QTest::newRow("unterminated array") << QByteArray("[1, 2") << int(QJsonParseError::UnterminatedArray);
+    QTest::newRow("unterminated object") << QByteArray(R"({"a": 1)") << int(QJsonParseError::UnterminatedObject);
+    QTest::newRow("unterminated string") << QByteArray(R"(["abc)") << int(QJsonParseError::UnterminatedString);
+    QTest::newRow("missing comma") << QByteArray("[1 2]") << int(QJsonParseError::MissingValueSeparator);
+    QTest::newRow("missing colon") << QByteArray(R"({"a" 1})") << int(QJsonParseError::MissingNameSeparator);
+    QTest::newRow("missing value") << QByteArray(R"({"a": })") << int(QJsonParseError::MissingObject);
+    QTest::newRow("bad number") << QByteArray("[01]") << int(QJsonParseError::IllegalNumber);
+    QTest::newRow("bad literal") << QByteArray("[truex]") << int(QJsonParseError::IllegalValue);
+    QTest::newRow("stray bracket") << QByteArray("1 ]") << int(QJsonParseError::MissingObject);
+}
+
+void TestJson::pushParserErrors()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(int, error);
+
+    // the state carried between feeds must not change the outcome
+    for (int chunkSize : {1, 3, int(json.size())}) {
+        QJsonVariantPushParser parser;
+        for (qsizetype i = 0; i < json.size(); i += chunkSize)
+            parser.feed(json.mid(i, chunkSize));
+        QVERIFY(!parser.finish());
+        QCOMPARE(int(parser.lastError()), error);
+    }
+}
+
+void TestJson::structuralIndex_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    for (const QString &fileName : {":/test.json", ":/test2.json", ":/test3.json", ":/test4.json"}) {
+        QFile file(fileName);
+        file.open(QFile::ReadOnly);
+        const QByteArray json = file.readAll();
+        QTest::newRow(qPrintable(fileName)) << json;
+        QTest::newRow(qPrintable(fileName + " compact")) << QJsonVariantWriter::fromVariant(QJsonVariantReader::fromJson(json));
+    }
+
+    // escapes and quotes on both sides of the 64-byte block boundaries
+    QByteArray escapes = "[";
+    for (int i = 0; i < 200; ++i)
+        escapes += '"' + QByteArray(2 * (i % 4), '\\') + QByteArray(i % 70, 'x') + "\\\"\",";
+    escapes += "\"\\u00e9\\n\\\"\"]";
+    QTest::newRow("escapes") << escapes;
+
+    QTest::newRow("scalar") << QByteArray("\xef\xbb\xbf -12.5e3 ");
+    QTest::newRow("string") << QByteArray(R"("a\"b")");
+    QTest::newRow("empty containers") << QByteArray(R"({"a": [], "b": {}, "c": [{}, []]})");
+    QTest::newRow("literals") << QByteArray("[true,false,null]");
+
+    // rejected by the index engine, left to the streaming one
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("trailing comma") << QByteArray("[1, 2,]");
+    QTest::newRow("missing comma") << QByteArray("[1 2]");
+    QTest::newRow("trailing data") << QByteArray("{} []");
+    QTest::newRow("unterminated") << QByteArray(R"({"a": [1, 2)");
+    QTest::newRow("unterminated string") << QByteArray(R"(["abc)");
+    QTest::newRow("bad literal") << QByteArray("[truex]");
+    QTest::newRow("bad number") << QByteArray("[01]");
+    QTest::newRow("missing value") << QByteArray(R"({"a": })");
+}
+
+void TestJson::structuralIndex()
+{
+    QFETCH(QByteArray, json);
+
+    QJsonParseError expectedError;
+    const QVariant expected = QJsonVariantReader::fromJson(json, &expectedError);
+
+    QJsonParseError error;
+    const QVariant result = QJsonVariantReader::fromJson(json, &error, QJsonVariantReader::StructuralIndexEngine);
+
+    QCOMPARE(result, expected);
+    QCOMPARE(error.error, expectedError.error);
+    QCOMPARE(error.offset, expectedError.offset);
+}
+
+void TestJson::parallelArray_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    QByteArray array = "\xef\xbb\xbf [";
+    for (int i = 0; i < 20000; ++i) {
+        if (i)
+            array.append(i % 2 ? ",\n" : " , ");
+        array.append(i % 3 ? QJsonVariantWriter::fromVariant(m_testVariant, i % 2)
+                           : QByteArray(R"({"a,]": "\"[,", "b": [1, {"c": ","}]})"));
+    }
+    QVERIFY(array.size() > 2 * QJsonVariantReader::MinimumSliceSize);
+
+    QTest::newRow("valid") << array + "] ";
+    QTest::newRow("trailing comma") << array + ",]";
+    QTest::newRow("unterminated") << array;
+    QTest::newRow("unterminated string") << array + R"(, "abc)";
+    QTest::newRow("illegal value") << array + ", {\"a\" 1}]";
+    QTest::newRow("illegal number") << array + ", 1.e]";
+    QTest::newRow("object") << "{\"a\": " + array + "]}";
+    QTest::newRow("small") << QByteArray("[1, 2, 3]");
+}
+
+void TestJson::parallelArray()
+{
+    QFETCH(QByteArray, json);
+
+    QJsonParseError expectedError;
+    const QVariant expected = QJsonVariantReader::fromJson(json, &expectedError);
+
+    QJsonParseError error;
+    const QVariant result = QJsonVariantReader::fromJsonParallel(json, &error);
+
+    QCOMPARE(result, expected);
+    QCOMPARE(error.error, expectedError.error);
+    QCOMPARE(error.offset, expectedError.offset);
+}
+
+void TestJson::jsonLines_data()
+{
+    QTest::addColumn<qint64>("batchSize");
+    QTest::addColumn<bool>("device");
+
+    QTest::newRow("1") << qint64(1) << false;
+    QTest::newRow("1 device") << qint64(1) << true;
+    QTest::newRow("100") << qint64(100) << false;
+    QTest::newRow("100 device") << qint64(100) << true;
+    QTest::newRow("default") << qint64(QJsonVariantLinesReader::DefaultBatchSize) << false;
+}
+
+void TestJson::jsonLines()
+{
+    QFETCH(qint64, batchSize);
+    QFETCH(bool, device);
+
+    QVariantList expected;
+    QByteArray json;
+    for (int i = 0; i < 200; ++i) {
+        const QVariant record = i % 2 ? m_testVariant : QVariant(QVariantList{i, QString::number(i)});
+        expected.append(QJsonVariantReader::fromJson(QJsonVariantWriter::fromVariant(record)));
+        json.append(QJsonVariantWriter::fromVariant(record));
+        json.append(i % 3 ? "\n" : "\r\n\n");
+    }
+    json.chop(1); // the last line may lack its line feed
+
+    QBuffer buffer(&json);
+    buffer.open(QIODevice::ReadOnly);
+    QScopedPointer<QJsonVariantLinesReader> reader(device ? new QJsonVariantLinesReader(&buffer)
+                                                          : new QJsonVariantLinesReader(json));
+    reader->setBatchSize(batchSize);
+    reader->setMaxPendingBatches(4);
+
+    QVariantList values;
+    while (!reader->atEnd())
+        values.append(reader->readBatch());
+
+    QVERIFY(!reader->hasError());
+    QCOMPARE(values, expected);
+    QCOMPARE(reader->currentOffset(), qint64(json.size()));
+}
+
+void TestJson::jsonLinesError()
+{
+    const QByteArray json = "{\"a\": 1}\n[1, 2]\n{\"b\": }\n3\n";
+
+    QJsonParseError error;
+    const QVariantList values = QJsonVariantLinesReader::fromJsonLines(json, &error);
+
+    QCOMPARE(error.error, QJsonParseError::MissingObject);
+    QCOMPARE(error.offset, int(json.indexOf('}', json.indexOf("\"b\""))));
+    QCOMPARE(values.size(), 2);
+}
+
 void TestJson::fileWriter_data()
 {
     QTest::addColumn<QString>("fileName");
@@ -170,6 +563,953 @@ void TestJson::fileWriter()
     QByteArray result = QJsonVariantWriter::fromVariant(variant, compact);
 
     QCOMPARE(result, expected);
+
+    // through a device, flushed in small pieces along the way
+    QByteArray written;
+    QBuffer buffer(&written);
+    {
+        QJsonVariantWriter writer(&buffer, compact);
+        writer.setFlushSize(100);
+        writer.start();
+        writer.writeVariant(variant);
+        QVERIFY(written.size() > 0);
+        QVERIFY(written.size() < expected.size());
+    }
+    QCOMPARE(written, expected);
+
+    // other indentations only change the leading whitespace
+    QByteArray expectedTabs;
+    for (const QByteArray &line : expected.split('\n')) {
+        qsizetype spaces = 0;
+        while (spaces < line.size() && line.at(spaces) == ' ')
+            ++spaces;
+        expectedTabs += QByteArray(spaces / 2, '\t') + line.mid(spaces) + '\n';
+    }
+    expectedTabs.chop(1);
+    QByteArray tabs;
+    {
+        QJsonVariantWriter writer(&tabs, compact);
+        writer.setIndentation(2, '\t');
+        writer.writeVariant(variant);
+    }
+    QCOMPARE(tabs, expectedTabs);
+}
+
+void TestJson::concurrentWriting()
+{
+    const QByteArray compact = QJsonVariantWriter::fromVariant(m_testVariant, true);
+    const QByteArray indented = QJsonVariantWriter::fromVariant(m_testVariant, false);
+    const QByteArray debug = QJsonVariantWriter::fromVariantDebug(m_testVariant);
+    QVERIFY(debug.contains("(QVariantMap)"));
+    QVERIFY(!compact.contains("(QVariantMap)"));
+
+    // debug writers running alongside must not leak type names into the
+    // plain ones
+    QThreadPool pool;
+    pool.setMaxThreadCount(8);
+    QAtomicInt mismatches;
+    for (int i = 0; i < 64; ++i) {
+        pool.start([&, i]() {
+            for (int j = 0; j < 50; ++j) {
+                bool ok;
+                switch ((i + j) % 3) {
+                case 0:
+                    ok = QJsonVariantWriter::fromVariant(m_testVariant, true) == compact;
+                    break;
+                case 1:
+                    ok = QJsonVariantWriter::fromVariant(m_testVariant, false) == indented;
+                    break;
+                default:
+                    ok = QJsonVariantWriter::fromVariantDebug(m_testVariant) == debug;
+                    break;
+                }
+                if (!ok)
+                    mismatches.ref();
+            }
+        });
+    }
+    pool.waitForDone();
+    QCOMPARE(mismatches.loadRelaxed(), 0);
+}
+
+void TestJson::parallelWriting_data()
+{
+    QTest::addColumn<QVariant>("variant");
+
+    for (const auto &row : TestData::parallelWritingRows(m_testVariant))
+        QTest::newRow(qPrintable(row.first)) << row.second;
+}
+
+void TestJson::parallelWriting()
+{
+    QFETCH(QVariant, variant);
+
+    // fewer threads than the five slices of the large containers, so
+    // slices also wait for a thread or run on the calling one
+    QThreadPool pool;
+    pool.setMaxThreadCount(4);
+
+    for (bool compact : {true, false}) {
+        const QByteArray expected = QJsonVariantWriter::fromVariant(variant, compact);
+        QCOMPARE(QJsonVariantWriter::fromVariantParallel(variant, compact, &pool), expected);
+
+        QBuffer buffer;
+        QJsonVariantWriter::fromVariantParallel(variant, &buffer, compact, &pool);
+        QCOMPARE(buffer.data(), expected);
+
+        QByteArray debug;
+        {
+            QJsonVariantWriter writer(&debug, compact);
+            writer.setShowType(true);
+            writer.setThreadPool(&pool);
+            writer.setIndentation(2, '\t');
+            writer.writeVariant(variant);
+        }
+        QByteArray expectedDebug;
+        {
+            QJsonVariantWriter writer(&expectedDebug, compact);
+            writer.setShowType(true);
+            writer.setIndentation(2, '\t');
+            writer.writeVariant(variant);
+        }
+        QCOMPARE(debug, expectedDebug);
+    }
+}
+
+static bool sameNumber(const QVariant &a, const QVariant &b)
+{
+    if (a.metaType() != b.metaType())
+        return false;
+    if (a.metaType().id() == QMetaType::Double) {
+        const double x = a.toDouble();
+        const double y = b.toDouble();
+        return std::memcmp(&x, &y, sizeof(double)) == 0;
+    }
+    return a == b;
+}
+
+void TestJson::numbers_data()
+{
+    QTest::addColumn<QByteArray>("number");
+
+    const char *numbers[] = {
+        "0", "-0", "1", "-1", "42", "9223372036854775807", "-9223372036854775808",
+        "9223372036854775808", "18446744073709551616", "0.1", "3.14159", "0.016",
+        "1e10", "1E-10", "-1.0e+2", "100.000", "0.30000000000000004",
+        "9007199254740993", "9007199254740993.0", "7.2057594037927933e16",
+        "2.2250738585072014e-308", "4.9e-324", "1.7976931348623157e308",
+        "123456789012345678901234567890", "1.00000000000000011102230246251565404236316680908203125",
+        // leading zeros are not JSON
+        "01", "-01", "00.1"
+    };
+    for (const char *number : numbers)
+        QTest::newRow(number) << QByteArray(number);
+}
+
+void TestJson::numbers()
+{
+    QFETCH(QByteArray, number);
+
+    const QByteArray json = "[" + number + "]";
+    QJsonParseError expectedError;
+    QVariant expected = QJsonDocument::fromJson(json, &expectedError).toVariant().toList().value(0);
+
+    // the index engine hands the whole token to QJsonNumber::parse()
+    for (QJsonVariantReader::Engine engine : {QJsonVariantReader::StreamingEngine, QJsonVariantReader::StructuralIndexEngine}) {
+        QJsonParseError error;
+        QVariant result = QJsonVariantReader::fromJson(json, &error, engine).toList().value(0);
+
+        QCOMPARE(error.error != QJsonParseError::NoError, expectedError.error != QJsonParseError::NoError);
+        if (expectedError.error == QJsonParseError::NoError)
+            QVERIFY2(sameNumber(result, expected), qPrintable(result.toString() + " != " + expected.toString()));
+    }
+}
+
+void TestJson::numberFormatting()
+{
+    const double doubles[] = {
+        0.0, -0.0, 1.0, -1.0, 0.1, 0.5, 1.5, 100.0, 123456.0, 1e6, 1e15, 1e16, 1e17, 1e21, 1e22,
+        0.001, 0.0001, 1e-5, 1.25e-5, 123.456, 3.14159, 0.30000000000000004, 1.0 / 3,
+        9007199254740993.0, 2.2250738585072014e-308, 4.9e-324, 1.7976931348623157e308,
+        12345678.9, 1.5e300, -2.5e-300, 65536.0, 1234567.0, 12345678.0,
+        // near ties between the fixed and exponent forms
+        1000.0, 10000.0, 100000.0, 1e7, 1200000.0, 0.01, -0.001, 0.00012
+    };
+    for (double d : doubles)
+        QCOMPARE(QJsonVariantWriter::fromVariant(d), QByteArray::number(d, 'g', QLocale::FloatingPointShortest));
+
+    // every exponent, with random digits
+    QRandomGenerator random(42);
+    for (int i = 0; i < 20000; ++i) {
+        quint64 bits = random.generate64();
+        double d;
+        std::memcpy(&d, &bits, sizeof(d));
+        if (!qIsFinite(d))
+            continue;
+        QCOMPARE(QJsonVariantWriter::fromVariant(d), QByteArray::number(d, 'g', QLocale::FloatingPointShortest));
+        // and short decimals, which are the common case
+        d = double(qint64(random.bounded(2000000)) - 1000000) / 1000;
+        QCOMPARE(QJsonVariantWriter::fromVariant(d), QByteArray::number(d, 'g', QLocale::FloatingPointShortest));
+    }
+
+    const qint64 integers[] = {
+        0, 1, -1, 9, 10, 99, 100, -100, 12345, 9999999999, std::numeric_limits<qint64>::max(),
+        std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::min() + 1
+    };
+    for (qint64 n : integers)
+        QCOMPARE(QJsonVariantWriter::fromVariant(qlonglong(n)), QByteArray::number(n));
+}
+
+// Every kernel of the scanner, as results and written bytes.
+static QList<qsizetype> scanBytes(const QByteArray &input)
+{
+    const char *begin = input.constData();
+    const char *end = begin + input.size();
+    QList<qsizetype> results {
+        QJsonScanner::skipWhitespace(begin, end) - begin,
+        QJsonScanner::findStringSpecial(begin, end) - begin,
+        QJsonScanner::findBracketOrQuote(begin, end) - begin,
+        QJsonScanner::findStructural(begin, end) - begin
+    };
+    QList<char16_t> widened(input.size());
+    const qsizetype count = QJsonScanner::widenAscii(begin, end, widened.data());
+    results.append(count);
+    for (qsizetype i = 0; i < count; ++i)
+        results.append(widened.at(i));
+    return results;
+}
+
+static QList<qsizetype> scanUnits(const QList<char16_t> &input)
+{
+    const char16_t *begin = input.constData();
+    const char16_t *end = begin + input.size();
+    QByteArray narrowed(input.size(), '\0');
+    const qsizetype count = QJsonScanner::narrowAscii(begin, end, narrowed.data());
+    QList<qsizetype> results { count, QJsonScanner::countAscii(begin, end) };
+    for (qsizetype i = 0; i < count; ++i)
+        results.append(uchar(narrowed.at(i)));
+    return results;
+}
+
+static QList<qsizetype> classifyBytes(const QByteArray &block)
+{
+    QJsonScanner::BlockMasks masks;
+    QJsonScanner::classifyBlock(block.constData(), &masks);
+    return { qsizetype(masks.backslash), qsizetype(masks.quote), qsizetype(masks.structural), qsizetype(masks.whitespace) };
+}
+
+// The first of sets whose scan of input differs from the scalar one's, or
+// the scalar set if they all agree.
+template <typename Input>
+static QJsonScanner::KernelSet differingKernelSet(const QList<QJsonScanner::KernelSet> &sets,
+                                                  QList<qsizetype> (*scan)(const Input &), const Input &input)
+{
+    QJsonScanner::setKernelSet(QJsonScanner::ScalarKernels);
+    const QList<qsizetype> expected = scan(input);
+    for (QJsonScanner::KernelSet set : sets) {
+        QJsonScanner::setKernelSet(set);
+        if (scan(input) != expected)
+            return set;
+    }
+    return QJsonScanner::ScalarKernels;
+}
+
+void TestJson::scannerKernels()
+{
+    // only the dispatched set runs otherwise: pin the others against the
+    // scalar one on this machine
+    const QJsonScanner::KernelSet original = QJsonScanner::kernelSet();
+    auto restore = qScopeGuard([original] { QJsonScanner::setKernelSet(original); });
+
+    QList<QJsonScanner::KernelSet> sets;
+    for (QJsonScanner::KernelSet set : {QJsonScanner::Sse2Kernels, QJsonScanner::Avx2Kernels}) {
+        if (QJsonScanner::setKernelSet(set))
+            sets.append(set);
+    }
+    if (sets.isEmpty())
+        QSKIP("only the scalar kernels are built for this CPU");
+
+    // one special byte or unit in a run of filler, at every position of
+    // inputs up to and past two 32-byte blocks, partial tails included
+    const char specials[] = { '"', '\\', '\x01', '\x1f', ' ', '\t', '\n', '\r', '[', ']', '{', '}', ',', ':',
+                              'x', '\x7f', char(0x80), char(0xe9), char(0xff) };
+    const char16_t units[] = { u'"', u'\\', 0x01, 0x1f, 0x20, 0x7f, 0x80, 0xe9, 0xff, 0x100, 0x7fff, 0x8000, 0xd800, 0xffff };
+    for (int size = 0; size <= 80; ++size) {
+        for (int position = 0; position < qMax(size, 1); ++position) {
+            for (char filler : {'a', ' '}) {
+                for (char special : specials) {
+                    QByteArray input(size, filler);
+                    if (position < size)
+                        input[position] = special;
+                    const QJsonScanner::KernelSet set = differingKernelSet(sets, scanBytes, input);
+                    QVERIFY2(set == QJsonScanner::ScalarKernels, qPrintable(QString("%1 bytes, 0x%2 at %3, kernel set %4")
+                                                                           .arg(size).arg(uint(uchar(special)), 2, 16, QChar('0'))
+                                                                           .arg(position).arg(int(set))));
+                }
+            }
+            for (char16_t unit : units) {
+                QList<char16_t> input(size, u'a');
+                if (position < size)
+                    input[position] = unit;
+                const QJsonScanner::KernelSet set = differingKernelSet(sets, scanUnits, input);
+                QVERIFY2(set == QJsonScanner::ScalarKernels, qPrintable(QString("%1 units, 0x%2 at %3, kernel set %4")
+                                                                       .arg(size).arg(uint(unit), 4, 16, QChar('0'))
+                                                                       .arg(position).arg(int(set))));
+            }
+        }
+    }
+
+    // whole blocks, mixing the same bytes at random
+    QRandomGenerator random(7);
+    for (int i = 0; i < 4096; ++i) {
+        QByteArray block(64, 'a');
+        for (char &c : block) {
+            if (random.bounded(3) == 0)
+                c = specials[random.bounded(int(sizeof(specials)))];
+        }
+        const QJsonScanner::KernelSet set = differingKernelSet(sets, classifyBytes, block);
+        QVERIFY2(set == QJsonScanner::ScalarKernels, qPrintable(QString("block %1, kernel set %2").arg(i).arg(int(set))));
+    }
+}
+
+void TestJson::strings_data()
+{
+    QTest::addColumn<QByteArray>("json");
+
+    QTest::newRow("plain") << QByteArray(R"(["Hello world"])");
+    QTest::newRow("escapes") << QByteArray(R"(["a\"b\\c\/d\b\f\n\r\t"])");
+    QTest::newRow("bmp escape") << QByteArray(R"(["caf\u00e9 \u263A \u4e2d"])");
+    QTest::newRow("surrogate pair") << QByteArray(R"(["smile \ud83d\ude0a!"])");
+    QTest::newRow("utf8 and escapes") << QByteArray("[\"Texte sp\xc3\xa9" "cial \\\"\xf0\x9f\x98\x8a\\\" \xe4\xb8\xad\\n\"]");
+    QTest::newRow("long ascii") << QByteArray("[\"" + QByteArray(100, 'x') + "\\t" + QByteArray(37, 'y') + "\"]");
+}
+
+void TestJson::strings()
+{
+    QFETCH(QByteArray, json);
+
+    QVariant expected = QJsonDocument::fromJson(json).toVariant();
+    QVariant result = QJsonVariantReader::fromJson(json);
+
+    QCOMPARE(result, expected);
+}
+
+void TestJson::stringWriting_data()
+{
+    QTest::addColumn<QString>("string");
+
+    QTest::newRow("empty") << QString();
+    QTest::newRow("ascii") << QString(u"Hello world");
+    QTest::newRow("escapes") << QString(u"a\"b\\c/d\b\f\n\r\t\x01\x1f\x7f");
+    QTest::newRow("non-ascii") << QString(u"caf\u00e9 \u263A \u4e2d \U0001F60A");
+    // specials on both sides of the 16 and 32 unit blocks
+    for (int i = 0; i < 70; i += 7) {
+        QString string(100, u'x');
+        string[i] = u'"';
+        string[99 - i] = u'\u00e9';
+        string[i + 15 < 100 ? i + 15 : 0] = u'\n';
+        QTest::newRow(qPrintable(QString("blocks %1").arg(i))) << string;
+    }
+    QTest::newRow("wide units") << QString(u"\u0141\u0122\u8022\u7f41") + QString(40, u'a') + QString(u"\u0100");
+    // a surrogate pair across the escaping chunks
+    QTest::newRow("long") << QString(4095, u'y') + QString(u"\U0001F60A") + QString(5000, u'z');
+}
+
+void TestJson::stringWriting()
+{
+    QFETCH(QString, string);
+
+    const QByteArray expected = QJsonDocument(QJsonArray({ string })).toJson(QJsonDocument::Compact);
+    QCOMPARE(QJsonVariantWriter::fromVariant(QVariantList({ string })), expected);
+
+    QVariantMap map;
+    map.insert(string, string);
+    QCOMPARE(QJsonVariantWriter::fromVariant(map), QJsonDocument(QJsonObject::fromVariantMap(map)).toJson(QJsonDocument::Compact));
+}
+
+void TestJson::serializedSize_data()
+{
+    QTest::addColumn<QVariant>("variant");
+
+    QTest::newRow("test variant") << m_testVariant;
+    QTest::newRow("empty containers") << QVariant(QVariantList{QVariantList(), QVariantMap(), QStringList(),
+                                                               QVariantMap{{"a", QVariantList()}}});
+    QTest::newRow("numbers") << QVariant(QVariantList{0, -1, 9, 10, 99999, -100000,
+                                                      std::numeric_limits<qint64>::min(), std::numeric_limits<qint64>::max(),
+                                                      std::numeric_limits<quint64>::max(), 1e21, 1.5e-7, -0.0, 0.1,
+                                                      qQNaN(), qInf(), 123456789.125, 1.0f / 3});
+    QTest::newRow("strings") << QVariant(QStringList{QString(), QString(u"a\"b\\c\b\f\n\r\t\x01\x7f"),
+                                                     QString(u"caf\u00e9 \u263A \U0001F60A"),
+                                                     QString(4095, u'y') + QString(u"\U0001F60A") + QString(5000, u'\u00e9'),
+                                                     QString(1, QChar(0xd800)) + QString(u"x") + QString(1, QChar(0xdc00)),
+                                                     QString(1, QChar(0xd83d))});
+    QVariantHash hash;
+    hash.insert(QString(u"k\u00e9y"), QVariantList{1, 2});
+    hash.insert("other", "value");
+    QTest::newRow("hash") << QVariant(hash);
+    QVariantPairList pairs;
+    pairs.append({"first", QVariantMap{{"x", 1}}});
+    pairs.append({"first", "duplicate"});
+    QTest::newRow("pair list") << QVariant::fromValue(pairs);
+    TestData::Person person;
+    person.name = "Ada";
+    person.height = 1.75;
+    person.tags = QStringList{"a", "b"};
+    QTest::newRow("gadget") << QVariant(QVariantList{QVariant::fromValue(person), 1});
+}
+
+void TestJson::serializedSize()
+{
+    QFETCH(QVariant, variant);
+
+    for (bool compact : {true, false}) {
+        const QByteArray json = QJsonVariantWriter::fromVariant(variant, compact);
+        QCOMPARE(QJsonVariantWriter::serializedSize(variant, compact), json.size());
+        QCOMPARE(QJsonVariantWriter::fromVariant(variant, compact, true), json);
+    }
+}
+
+void TestJson::mapTypes_data()
+{
+    QTest::addColumn<QString>("fileName");
+    QTest::addColumn<int>("mapType");
+
+    for (const char *fileName : {":/test.json", ":/test3.json"}) {
+        QTest::addRow("%s hash", fileName) << fileName << int(QVariantReader::VariantHash);
+        QTest::addRow("%s pair list", fileName) << fileName << int(QVariantReader::VariantPairList);
+    }
+}
+
+void TestJson::mapTypes()
+{
+    QFETCH(QString, fileName);
+    QFETCH(int, mapType);
+
+    QFile file(fileName);
+    file.open(QFile::ReadOnly);
+    QByteArray json = file.readAll();
+
+    QJsonVariantReader reader(json);
+    reader.setMapType(QVariantReader::MapType(mapType));
+    QVariant result = reader.read();
+
+    QCOMPARE(TestData::normalized(result), QJsonDocument::fromJson(json).toVariant());
+}
+
+void TestJson::pairListRoundTrip()
+{
+    const QByteArray json = R"({"b":1,"a":[{"z":true,"y":null,"z":"dup"}],"c":{}})";
+
+    QJsonVariantReader reader(json);
+    reader.setMapType(QVariantReader::VariantPairList);
+    QVariant result = reader.read();
+
+    QCOMPARE(result.metaType(), QMetaType::fromType<QVariantPairList>());
+    QCOMPARE(QJsonVariantWriter::fromVariant(result), json);
+}
+
+void TestJson::skipValue()
+{
+    QFile file(":/test.json");
+    file.open(QFile::ReadOnly);
+    QByteArray json = file.readAll();
+    const QVariantList expected = QJsonDocument::fromJson(json).toVariant().toList();
+
+    QJsonVariantReader reader(json);
+    QVERIFY(reader.isList());
+    QVERIFY(reader.enterContainer());
+    int count = 0;
+    while (reader.hasNext()) {
+        // skip every other element and check the one read after it
+        if (count % 2 == 0) {
+            QVERIFY(reader.skipValue());
+        } else {
+            QCOMPARE(reader.read(), expected.at(count));
+        }
+        ++count;
+    }
+    QVERIFY(reader.leaveContainer());
+    QCOMPARE(count, expected.size());
+    QVERIFY(reader.atEnd());
+    QCOMPARE(reader.lastError(), QJsonParseError::NoError);
+}
+
+void TestJson::findKey()
+{
+    QFile file(":/test3.json");
+    file.open(QFile::ReadOnly);
+    QByteArray json = file.readAll();
+    const QVariantMap expected = QJsonDocument::fromJson(json).toVariant().toMap();
+
+    QJsonVariantReader reader(json);
+    QVERIFY(reader.enterContainer());
+    QVERIFY(reader.findKey(u"address"));
+    QCOMPARE(reader.read(), expected.value("address"));
+    QVERIFY(reader.findKey(u"phoneNumber"));
+    QCOMPARE(reader.read(), expected.value("phoneNumber"));
+    QVERIFY(!reader.findKey(u"firstName"));
+    QVERIFY(reader.leaveContainer());
+    QCOMPARE(reader.lastError(), QJsonParseError::NoError);
+
+    QJsonVariantReader escaped(R"({"a\u0062c": 1, "x\"y": [2, "]"], "abc": 3})");
+    QVERIFY(escaped.enterContainer());
+    QVERIFY(escaped.findKey(u"abc"));
+    QCOMPARE(escaped.read(), QVariant(1ll));
+    QVERIFY(escaped.findKey(u"abc"));
+    QCOMPARE(escaped.read(), QVariant(3ll));
+}
+
+void TestJson::handler_data()
+{
+    fileParser_data();
+}
+
+void TestJson::handler()
+{
+    QFETCH(QString, fileName);
+
+    QFile file(fileName);
+    file.open(QFile::ReadOnly);
+    QByteArray json = file.readAll();
+
+    QJsonVariantReader reader(json);
+    TestData::VariantBuilder builder;
+    QVERIFY(reader.parse(&builder));
+    QVERIFY(!reader.hasError());
+    QCOMPARE(builder.result, QJsonVariantReader::fromJson(json));
+}
+
+void TestJson::handlerViews()
+{
+    // plain strings are views into the input, escaped ones are decoded
+    QJsonVariantReader reader(QByteArray(R"({"plain": "abc", "escaped": "a\nb", "a\u00e9": [1, 2.5, true, null]})"));
+    TestData::VariantBuilder builder;
+    QVERIFY(reader.parse(&builder));
+    QCOMPARE(builder.utf8Views, 3);
+    QCOMPARE(builder.utf16Views, 2);
+    QCOMPARE(builder.result, QVariant(QVariantMap{
+        {"plain", "abc"},
+        {"escaped", "a\nb"},
+        {QString(u"a\u00e9"), QVariantList{1ll, 2.5, true, QVariant::fromValue(nullptr)}}
+    }));
+
+    // a handler returning false stops the parse
+    struct Stop : QVariantHandler {
+        bool number(double) override { return false; }
+    } stop;
+    QJsonVariantReader stopped(QByteArray("[1, 2.5, 3]"));
+    QVERIFY(!stopped.parse(&stop));
+    QVERIFY(!stopped.hasError());
+}
+
+void TestJson::gadgets()
+{
+    const QByteArray json = R"({"name": "Ada", "unknown": [1, {"name": "x"}], "height": 1.75, "active": true,
+                                "tags": ["a", "b"], "address": {"street": "Main", "number": 5}})";
+
+    QJsonVariantReader reader(json);
+    const TestData::Person person = reader.readInto<TestData::Person>();
+    QVERIFY(!reader.hasError());
+    QCOMPARE(person.name, QString("Ada"));
+    QCOMPARE(person.height, 1.75);
+    QCOMPARE(person.active, true);
+    QCOMPARE(person.tags, QStringList({"a", "b"}));
+    QCOMPARE(person.address.street, QString("Main"));
+    QCOMPARE(person.address.number, 5);
+
+    // written in declaration order, straight from the properties
+    QByteArray written;
+    {
+        QJsonVariantWriter writer(&written);
+        writer.writeGadget(person);
+    }
+    QCOMPARE(written, QByteArray(R"({"name":"Ada","height":1.75,"active":true,"tags":["a","b"],"address":{"street":"Main","number":5}})"));
+    QCOMPARE(QJsonVariantWriter::fromVariant(QVariant::fromValue(person)), written);
+
+    QJsonVariantReader objectReader(QByteArray(R"({"level": 3, "mode": "fast", "objectName": "s"})"));
+    Settings settings;
+    QVERIFY(objectReader.readInto(&settings));
+    QCOMPARE(settings.level, 3);
+    QCOMPARE(settings.mode, QString("fast"));
+    QCOMPARE(settings.objectName(), QString("s"));
+
+    QJsonVariantReader listReader(QByteArray("[1, 2]"));
+    TestData::Person none;
+    QVERIFY(!listReader.readInto(&none));
+}
+
+void TestJson::validate_data()
+{
+    structuralIndex_data();
+
+    QTest::newRow("unterminated key") << QByteArray(R"({"a": 1, "b)");
+    QTest::newRow("number key") << QByteArray(R"({1: 2})");
+    QTest::newRow("nested error") << QByteArray(R"([[1, {"a": [tru]}], 2])");
+    QTest::newRow("unterminated object") << QByteArray(R"([{"a": 1)");
+}
+
+void TestJson::validate()
+{
+    QFETCH(QByteArray, json);
+
+    QJsonParseError expectedError;
+    QJsonVariantReader::fromJson(json, &expectedError);
+
+    QJsonParseError error;
+    QCOMPARE(QJsonVariantReader::validate(json, &error), expectedError.error == QJsonParseError::NoError);
+    QCOMPARE(error.error, expectedError.error);
+    QCOMPARE(error.offset, expectedError.offset);
+
+    QBuffer buffer(&json);
+    buffer.open(QIODevice::ReadOnly);
+    QJsonParseError deviceError;
+    QJsonVariantReader::validate(&buffer, &deviceError);
+    QCOMPARE(deviceError.error, expectedError.error);
+    QCOMPARE(deviceError.offset, expectedError.offset);
+}
+
+void TestJson::formatter_data()
+{
+    validate_data();
+}
+
+void TestJson::formatter()
+{
+    QFETCH(QByteArray, json);
+
+    QJsonVariantReader reader(json);
+    reader.setMapType(QVariantReader::VariantPairList);
+    const QVariant variant = reader.read();
+    const QJsonParseError expectedError = reader.error();
+
+    for (bool compact : {true, false}) {
+        QJsonParseError error;
+        const QByteArray result = QJsonFormatter::format(json, compact, &error);
+        QCOMPARE(error.error, expectedError.error);
+        QCOMPARE(error.offset, expectedError.offset);
+        if (expectedError.error == QJsonParseError::NoError)
+            QCOMPARE(result, QJsonVariantWriter::fromVariant(variant, compact));
+
+        QBuffer input(&json);
+        input.open(QIODevice::ReadOnly);
+        QByteArray deviceResult;
+        QBuffer output(&deviceResult);
+        output.open(QIODevice::WriteOnly);
+        QJsonParseError deviceError;
+        QCOMPARE(QJsonFormatter::format(&input, &output, compact, &deviceError), expectedError.error == QJsonParseError::NoError);
+        QCOMPARE(deviceError.error, expectedError.error);
+        QCOMPARE(deviceError.offset, expectedError.offset);
+        if (expectedError.error == QJsonParseError::NoError)
+            QCOMPARE(deviceResult, result);
+    }
+}
+
+void TestJson::transcoder_data()
+{
+    validate_data();
+}
+
+void TestJson::transcoder()
+{
+    QFETCH(QByteArray, json);
+
+    QJsonParseError expectedError;
+    const QVariant expected = QJsonVariantReader::fromJson(json, &expectedError);
+
+    QJsonParseError error;
+    const QByteArray cbor = QJsonCborTranscoder::jsonToCbor(json, 0, &error);
+    QCOMPARE(error.error, expectedError.error);
+    QCOMPARE(error.offset, expectedError.offset);
+
+    QBuffer input(&json);
+    input.open(QIODevice::ReadOnly);
+    QByteArray deviceCbor;
+    QBuffer output(&deviceCbor);
+    output.open(QIODevice::WriteOnly);
+    QJsonParseError deviceError;
+    QCOMPARE(QJsonCborTranscoder::jsonToCbor(&input, &output, 0, &deviceError), expectedError.error == QJsonParseError::NoError);
+    QCOMPARE(deviceError.error, expectedError.error);
+    QCOMPARE(deviceError.offset, expectedError.offset);
+
+    if (expectedError.error != QJsonParseError::NoError)
+        return;
+    QCOMPARE(deviceCbor, cbor);
+    QCOMPARE(QCborVariantReader::fromCbor(cbor), expected);
+
+    // and back, keeping the source order
+    QCborVariantReader reader(cbor);
+    reader.setMapType(QVariantReader::VariantPairList);
+    const QVariant variant = reader.read();
+    for (bool compact : {true, false}) {
+        QCborParserError cborError;
+        QCOMPARE(QJsonCborTranscoder::cborToJson(cbor, compact, &cborError), QJsonVariantWriter::fromVariant(variant, compact));
+        QVERIFY(cborError.error == QCborError::NoError);
+    }
+}
+
+void TestJson::transcoderCbor()
+{
+    // values without a direct JSON counterpart take the QVariant route
+    QByteArray cbor;
+    {
+        QCborStreamWriter writer(&cbor);
+        writer.startMap();
+        writer.append(QLatin1String("bytes"));
+        writer.append(QByteArray("a\"b"));
+        writer.append(QLatin1String("tagged"));
+        writer.startArray(2);
+        writer.append(QCborKnownTags::DateTimeString);
+        writer.append(QLatin1String("2020-01-02T03:04:05Z"));
+        writer.append(QCborKnownTags::Url);
+        writer.append(QLatin1String("https://example.com"));
+        writer.endArray();
+        writer.append(QLatin1String("integers"));
+        writer.startArray();
+        writer.append(std::numeric_limits<quint64>::max());
+        writer.append(QCborNegativeInteger(std::numeric_limits<quint64>::max()));
+        writer.append(QCborNegativeInteger(quint64(1) << 63));
+        writer.append(qint64(-1));
+        writer.endArray();
+        writer.append(QLatin1String("floats"));
+        writer.startArray();
+        writer.append(qfloat16(1.5));
+        writer.append(0.25f);
+        writer.append(qInf());
+        writer.endArray();
+        writer.append(QLatin1String("simple"));
+        writer.startArray();
+        writer.appendUndefined();
+        writer.append(QCborSimpleType(32));
+        writer.append(nullptr);
+        writer.endArray();
+        writer.append(qint64(7));
+        writer.startMap(1);
+        writer.append(QLatin1String("nested"));
+        writer.append(QCborKnownTags::ExpectedBase64);
+        writer.startArray(0);
+        writer.endArray();
+        writer.endMap();
+        writer.endMap();
+    }
+
+    QCborVariantReader reader(cbor);
+    reader.setMapType(QVariantReader::VariantPairList);
+    const QVariant variant = reader.read();
+    for (bool compact : {true, false}) {
+        QCborParserError error;
+        QCOMPARE(QJsonCborTranscoder::cborToJson(cbor, compact, &error), QJsonVariantWriter::fromVariant(variant, compact));
+        QVERIFY(error.error == QCborError::NoError);
+    }
+
+    // a device that cannot be mapped is streamed
+    QBuffer input(&cbor);
+    input.open(QIODevice::ReadOnly);
+    QByteArray json;
+    QBuffer output(&json);
+    output.open(QIODevice::WriteOnly);
+    QVERIFY(QJsonCborTranscoder::cborToJson(&input, &output));
+    QCOMPARE(json, QJsonVariantWriter::fromVariant(variant));
+
+    QByteArray truncated = cbor.left(cbor.size() - 3);
+    QCborParserError expectedError;
+    QCborVariantReader::fromCbor(truncated, &expectedError);
+    QCborParserError error;
+    QJsonCborTranscoder::cborToJson(truncated, true, &error);
+    QVERIFY(error.error == expectedError.error);
+    QCOMPARE(error.offset, expectedError.offset);
+
+    QBuffer truncatedInput(&truncated);
+    truncatedInput.open(QIODevice::ReadOnly);
+    output.reset();
+    QVERIFY(!QJsonCborTranscoder::cborToJson(&truncatedInput, &output, true, &error));
+    QVERIFY(error.error != QCborError::NoError);
+
+    // text that is not UTF-8 is refused with its own error
+    QByteArray invalidUtf8("\x82\x01\x62\xff\xfe");
+    QJsonCborTranscoder::cborToJson(invalidUtf8, true, &error);
+    QVERIFY(error.error == QCborError::InvalidUtf8String);
+    QBuffer invalidInput(&invalidUtf8);
+    invalidInput.open(QIODevice::ReadOnly);
+    output.reset();
+    QVERIFY(!QJsonCborTranscoder::cborToJson(&invalidInput, &output, true, &error));
+    QVERIFY(error.error == QCborError::InvalidUtf8String);
+}
+
+void TestJson::extract_data()
+{
+    QTest::addColumn<QByteArray>("json");
+    QTest::addColumn<QString>("pointer");
+    QTest::addColumn<QString>("other");
+
+    QFile file(":/test.json");
+    file.open(QFile::ReadOnly);
+    const QByteArray json = file.readAll();
+
+    for (const char *pointer : {"", "/0", "/8/integer", "/8/quote", "/8/compact/2", "/8/", "/8/object/",
+                                "/8/0123456789", "/8/a~1b", "/8/missing", "/9", "/8/jsontext", "/12"})
+        QTest::newRow(pointer) << json << QString::fromLatin1(pointer) << QStringLiteral("/8/one");
+
+    // the last duplicate wins, and is not counted as another pointer found
+    QTest::newRow("duplicate key") << QByteArray(R"({"a":1,"a":2,"b":3})") << QStringLiteral("/a") << QStringLiteral("/b");
+}
+
+// Resolves pointer on the fully parsed document, as a reference.
+static QVariant resolvePointer(const QVariant &document, const QString &pointer)
+{
+    QVariant reference = document;
+    const QStringList tokens = pointer.split(u'/').mid(1);
+    for (QString token : tokens) {
+        token.replace("~1", "/").replace("~0", "~");
+        if (reference.metaType().id() == QMetaType::QVariantList) {
+            bool ok = false;
+            const int index = token.toInt(&ok);
+            reference = ok ? reference.toList().value(index) : QVariant();
+        } else if (reference.metaType().id() == QMetaType::QVariantMap) {
+            reference = reference.toMap().value(token);
+        } else {
+            reference = QVariant();
+        }
+    }
+    return reference;
+}
+
+void TestJson::extract()
+{
+    QFETCH(QByteArray, json);
+    QFETCH(QString, pointer);
+    QFETCH(QString, other);
+
+    const QVariant document = QJsonDocument::fromJson(json).toVariant();
+
+    QJsonParseError error;
+    const QVariantList result = QJsonVariantReader::extract(json, {pointer, other}, &error);
+
+    QCOMPARE(error.error, QJsonParseError::NoError);
+    QCOMPARE(result.size(), 2);
+    QCOMPARE(result.at(0), resolvePointer(document, pointer));
+    QCOMPARE(result.at(1), resolvePointer(document, other));
+}
+
+void TestJson::interning()
+{
+    const QByteArray json = R"([{"id": 1, "state": "on", "café": "a long value that should not be interned"},
+                               {"id": 2, "state": "on", "café": "a long value that should not be interned"}])";
+
+    QJsonVariantReader reader(json);
+    reader.setReadOptions(QVariantReader::InternKeys | QVariantReader::InternStrings);
+    reader.setInternStringLimit(8);
+    const QVariantList result = reader.read().toList();
+
+    QCOMPARE(QVariant(result), QJsonDocument::fromJson(json).toVariant());
+
+    const QVariantMap first = result.at(0).toMap();
+    const QVariantMap second = result.at(1).toMap();
+    QCOMPARE(first.firstKey().constData(), second.firstKey().constData());
+    QCOMPARE(first.lastKey().constData(), second.lastKey().constData());
+    QCOMPARE(first.value("state").toString().constData(), second.value("state").toString().constData());
+    QVERIFY(first.value("café").toString().constData() != second.value("café").toString().constData());
+}
+
+void TestJson::numberBenchmark()
+{
+    QRandomGenerator random(42);
+    QByteArray json = "[";
+    for (int i = 0; i < 100000; ++i) {
+        if (i)
+            json += ',';
+        switch (i % 3) {
+        case 0:
+            json += QByteArray::number(qint64(random.generate64() >> (i % 60)));
+            break;
+        case 1:
+            json += QByteArray::number(random.generateDouble() * 1000, 'g', QLocale::FloatingPointShortest);
+            break;
+        default:
+            json += QByteArray::number((random.generateDouble() * 2 - 1) * 1e300, 'e', i % 17);
+            break;
+        }
+    }
+    json += "]";
+
+    const QVariantList expected = QJsonDocument::fromJson(json).toVariant().toList();
+    const QVariantList result = QJsonVariantReader::fromJson(json).toList();
+    QCOMPARE(result.size(), expected.size());
+    for (qsizetype i = 0; i < result.size(); ++i)
+        QVERIFY2(sameNumber(result.at(i), expected.at(i)), qPrintable(QString::number(i)));
+
+    QBENCHMARK {
+        QJsonDocument::fromJson(json).toVariant();
+    }
+    QBENCHMARK {
+        QJsonVariantReader::fromJson(json);
+    }
+}
+
+// Records as a typical API response has them: short keys, mostly plain
+// strings, some escapes and numbers, shallow nesting.
+static QVariantList benchmarkRecords()
+{
+    QRandomGenerator random(42);
+    QVariantList records;
+    for (int i = 0; i < 20000; ++i) {
+        QVariantMap record;
+        record.insert("id", i);
+        record.insert("name", QString("user %1").arg(random.generate()));
+        record.insert("email", QString("user%1@example.com").arg(i));
+        record.insert("bio", i % 10 ? QString("plain text, nothing to escape here")
+                                    : QString("quoted \"text\"\twith\nescapes \u00e9"));
+        record.insert("score", random.generateDouble() * 100);
+        record.insert("active", i % 3 == 0);
+        record.insert("tags", QVariantList{"alpha", "beta", i % 7});
+        record.insert("address", QVariantMap{{"city", "Paris"}, {"zip", 75000 + i % 20}});
+        records.append(record);
+    }
+    return records;
+}
+
+void TestJson::structuralIndexBenchmark()
+{
+    const QVariantList records = benchmarkRecords();
+    const QJsonDocument doc = QJsonDocument::fromVariant(records);
+
+    for (QJsonDocument::JsonFormat format : {QJsonDocument::Indented, QJsonDocument::Compact}) {
+        const QByteArray json = doc.toJson(format);
+        QCOMPARE(QJsonVariantReader::fromJson(json, nullptr, QJsonVariantReader::StructuralIndexEngine),
+                 QJsonVariantReader::fromJson(json));
+
+        QBENCHMARK {
+            QJsonDocument::fromJson(json).toVariant();
+        }
+        QBENCHMARK {
+            QJsonVariantReader::fromJson(json);
+        }
+        QBENCHMARK {
+            QJsonVariantReader::fromJson(json, nullptr, QJsonVariantReader::StructuralIndexEngine);
+        }
+    }
+}
+
+void TestJson::transcoderBenchmark()
+{
+    const QVariantList records = benchmarkRecords();
+    const QByteArray cbor = QCborValue::fromVariant(records).toCbor();
+
+    for (bool compact : {true, false}) {
+        const QByteArray json = QJsonVariantWriter::fromVariant(records, compact);
+
+        QBENCHMARK {
+            QCborVariantWriter::fromVariant(QJsonVariantReader::fromJson(json));
+        }
+        QBENCHMARK {
+            QJsonCborTranscoder::jsonToCbor(json);
+        }
+        QBENCHMARK {
+            QJsonVariantWriter::fromVariant(QCborVariantReader::fromCbor(cbor), compact);
+        }
+        QBENCHMARK {
+            QJsonCborTranscoder::cborToJson(cbor, compact);
+        }
+    }
 }
 
 void TestJson::benchmark_data()
@@ -220,6 +1560,9 @@ void TestJson::benchmark()
     QBENCHMARK {
         QJsonVariantReader::fromJson(json);
     }
+    QBENCHMARK {
+        QJsonVariantReader::fromJson(json, nullptr, QJsonVariantReader::StructuralIndexEngine);
+    }
     QBENCHMARK {
         QCborValue::fromCbor(cbor).toVariant();
     }
@@ -233,12 +1576,60 @@ void TestJson::benchmark()
     QBENCHMARK {
         QJsonVariantWriter::fromVariant(variant, compact);
     }
+    QBENCHMARK {
+        QJsonVariantWriter::fromVariantParallel(variant, compact);
+    }
     QBENCHMARK {
         QCborValue::fromVariant(variant).toCbor(compact ? QCborValue::UseFloat16 : QCborValue::NoTransformation);
     }
     QBENCHMARK {
         QCborVariantWriter::fromVariant(variant, compact ? QCborValue::UseFloat16 : QCborValue::NoTransformation);
     }
+    QBENCHMARK {
+        QCborVariantWriter::fromVariantParallel(variant, compact ? QCborValue::UseFloat16 : QCborValue::NoTransformation);
+    }
+
+    QBENCHMARK {
+        QCborVariantWriter::fromVariant(QJsonVariantReader::fromJson(json));
+    }
+    QBENCHMARK {
+        QJsonCborTranscoder::jsonToCbor(json);
+    }
+    QBENCHMARK {
+        QJsonVariantWriter::fromVariant(QCborVariantReader::fromCbor(cbor), compact);
+    }
+    QBENCHMARK {
+        QJsonCborTranscoder::cborToJson(cbor, compact);
+    }
+}
+
+void TestJson::threadedWriting_data()
+{
+    QTest::addColumn<int>("threads");
+
+    QTest::newRow("1 thread") << 1;
+    QTest::newRow("2 threads") << 2;
+    QTest::newRow("4 threads") << 4;
+    QTest::newRow("8 threads") << 8;
+}
+
+void TestJson::threadedWriting()
+{
+    QFETCH(int, threads);
+
+    // the same number of documents per thread, so time per iteration stays
+    // flat for as long as the writers scale
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    QBENCHMARK {
+        for (int i = 0; i < threads; ++i) {
+            pool.start([this]() {
+                for (int j = 0; j < 1000; ++j)
+                    QJsonVariantWriter::fromVariant(m_testVariant);
+            });
+        }
+        pool.waitForDone();
+    }
 }
 
 QTEST_APPLESS_MAIN(TestJson)